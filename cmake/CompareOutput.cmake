@@ -0,0 +1,47 @@
+# Runs COMMAND with ARGUMENTS (a list) in WORKING_DIRECTORY, with the file INPUT as stdin if given,
+# and compares what it prints with the file EXPECTED.
+# Line ends and spaces at the ends of lines are not compared, unless BINARY is set: then every byte is.
+
+if ( DEFINED INPUT )
+    set( inputOption INPUT_FILE ${INPUT} )
+endif ()
+
+get_filename_component( expectedName ${EXPECTED} NAME )
+set( actualFile ${CMAKE_CURRENT_BINARY_DIR}/actual_${expectedName} )
+
+if ( BINARY )
+    set( outputOption OUTPUT_FILE ${actualFile} )
+else ()
+    set( outputOption OUTPUT_VARIABLE actual )
+endif ()
+
+execute_process( COMMAND ${COMMAND} ${ARGUMENTS}
+                 WORKING_DIRECTORY ${WORKING_DIRECTORY}
+                 ${inputOption}
+                 ${outputOption}
+                 RESULT_VARIABLE result )
+
+if ( NOT result EQUAL 0 )
+    message( FATAL_ERROR "${COMMAND} exited with ${result}" )
+endif ()
+
+if ( BINARY )
+    execute_process( COMMAND ${CMAKE_COMMAND} -E compare_files ${actualFile} ${EXPECTED} RESULT_VARIABLE different )
+    if ( different )
+        message( FATAL_ERROR "The output differs from ${EXPECTED}; it is in ${actualFile}" )
+    endif ()
+    return ()
+endif ()
+
+file( READ ${EXPECTED} expected )
+
+foreach ( name actual expected )
+    string( REPLACE "\r" "" ${name} "${${name}}" )
+    string( REGEX REPLACE " +\n" "\n" ${name} "${${name}}" )
+    string( REGEX REPLACE "[ \n]+$" "" ${name} "${${name}}" )
+endforeach ()
+
+if ( NOT actual STREQUAL expected )
+    file( WRITE ${actualFile} "${actual}" )
+    message( FATAL_ERROR "The output differs from ${EXPECTED}; it is in ${actualFile}" )
+endif ()
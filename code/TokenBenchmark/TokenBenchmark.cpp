@@ -0,0 +1,339 @@
+﻿# include "TokenBenchmark.h"
+
+# include <sstream>
+# include <iomanip>
+# include <thread>
+# include <ctime>
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+
+/*
+ * Times CutLine, CutFile, GetToken and Output of TokenProcessor v1, v2 and v3 on
+ * synthetic corpora, and writes the results as Google Benchmark style JSON.
+ *
+ *   TokenBenchmark [--bytes=N] [--min-time=S] [--repetitions=N] [--filter=TEXT]
+ *                  [--dir=PATH] [--out=FILE] [--keep]
+ *
+ * The JSON goes to FILE (or to stdout), a side by side table in MB/s to stderr.
+ * --keep leaves the corpora in PATH, to train or try other programs on them.
+ */
+
+// A fixed generator, so every run and every machine cuts the same text.
+class CorpusRandom {
+    unsigned long long mState ;
+public:
+    explicit CorpusRandom( unsigned long long seed ) : mState( seed ) {} // constructor
+    unsigned int Next( unsigned int bound ) {
+        mState = mState * 6364136223846793005ULL + 1442695040888963407ULL ;
+        return ( unsigned int ) ( ( mState >> 33 ) % bound ) ;
+    } // Next()
+} ; // class CorpusRandom
+
+static const char * const kWords[] = {
+    "int", "value", "count", "index", "buffer", "result", "token", "length", "offset", "node",
+    "left", "right", "parent", "_next", "data_ptr", "mState", "kMaxSize", "i", "j", "tmp"
+} ;
+
+static const char * const kOperators[] = {
+    "+=", "-=", "*=", "/=", "%=", "<<=", ">>=", "->", "->*", "::", "++", "--", "==", "!=",
+    "<=", ">=", "&&", "||", "&=", "|=", "^=", "<<", ">>", "+", "-", "*", "/", "%", "<", ">",
+    "(", ")", "[", "]", "{", "}", ";", ",", "?", ":", "!", "~", "&", "|", "^", ".*", "##"
+} ;
+
+static const char * const kText[] = {
+    "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "\\\"quoted\\\"", "\\n", "\\t", "1.5"
+} ;
+
+# define COUNT_OF( array ) ( sizeof( array ) / sizeof( array[0] ) )
+
+static std::string IdentifierLine( CorpusRandom & random ) {
+
+    std::string line ;
+    int words = 6 + random.Next( 8 ) ;
+    for ( int i = 0 ; i < words ; i++ ) {
+        line += kWords[random.Next( COUNT_OF( kWords ) )] ;
+        if ( random.Next( 3 ) == 0 ) {
+            line += std::to_string( random.Next( 100 ) ) ;
+        } // if
+
+        line += ( i + 1 < words && random.Next( 4 ) == 0 ) ? " = " : " " ;
+    } // for
+
+    return line + ";" ;
+
+} // IdentifierLine()
+
+// Like the operator stages of test01.txt: short operands packed between operators.
+static std::string OperatorLine( CorpusRandom & random ) {
+
+    std::string line ;
+    int operators = 16 + random.Next( 16 ) ;
+    for ( int i = 0 ; i < operators ; i++ ) {
+        if ( random.Next( 2 ) == 0 ) {
+            line += ( char ) ( 'a' + random.Next( 26 ) ) ;
+        } // if
+        else {
+            line += std::to_string( random.Next( 10 ) ) ;
+        } // else
+
+        line += kOperators[random.Next( COUNT_OF( kOperators ) )] ;
+    } // for
+
+    return line ;
+
+} // OperatorLine()
+
+static std::string NumberLine( CorpusRandom & random ) {
+
+    std::string line ;
+    for ( int column = 0 ; column < 8 ; column++ ) {
+        if ( column > 0 ) {
+            line += ( column % 2 == 0 ) ? ", " : "  " ;
+        } // if
+
+        unsigned int whole = random.Next( 1000000 ) ;
+        if ( random.Next( 2 ) == 0 ) {
+            line += std::to_string( whole ) ;
+        } // if
+        else {
+            line += std::to_string( whole ) + "." + std::to_string( random.Next( 100000 ) ) ;
+        } // else
+    } // for
+
+    return line ;
+
+} // NumberLine()
+
+static std::string StringLine( CorpusRandom & random ) {
+
+    std::string line = "text = \"" ;
+    int words = 30 + random.Next( 30 ) ;
+    for ( int i = 0 ; i < words ; i++ ) {
+        line += kText[random.Next( COUNT_OF( kText ) )] ;
+        line += ' ' ;
+    } // for
+
+    return line + "\" ;" ;
+
+} // StringLine()
+
+static std::string ShortLine( CorpusRandom & random ) {
+
+    switch ( random.Next( 5 ) ) {
+    case 0 : return "}" ;
+    case 1 : return "i++ ;" ;
+    case 2 : return kWords[random.Next( COUNT_OF( kWords ) )] ;
+    case 3 : return "" ;
+    default : return "x = " + std::to_string( random.Next( 10 ) ) ;
+    } // switch
+
+} // ShortLine()
+
+static BenchmarkCorpus MakeCorpus( const char * name, std::string ( * makeLine )( CorpusRandom & ),
+                                   size_t bytes, const std::string & directory ) {
+
+    BenchmarkCorpus corpus ;
+    CorpusRandom random( 20240601 ) ;
+    corpus.name = name ;
+    corpus.path = directory + "/TokenBenchmark_" + name + ".txt" ;
+
+    std::ofstream outFile( corpus.path.c_str(), std::ios::out | std::ios::binary ) ;
+    while ( corpus.bytes < bytes ) {
+        std::string line = makeLine( random ) ;
+        outFile << line << '\n' ;
+        corpus.bytes += line.size() + 1 ;
+        corpus.lines.push_back( line ) ;
+    } // while
+
+    if ( !outFile ) {
+        std::cerr << "Can not write " << corpus.path << "\n" ;
+        exit( 1 ) ;
+    } // if
+
+    return corpus ;
+
+} // MakeCorpus()
+
+std::vector<BenchmarkCorpus> MakeCorpora( size_t bytes, const std::string & directory ) {
+
+    std::vector<BenchmarkCorpus> corpora ;
+    corpora.push_back( MakeCorpus( "identifiers", IdentifierLine, bytes, directory ) ) ;
+    corpora.push_back( MakeCorpus( "operators", OperatorLine, bytes, directory ) ) ;
+    corpora.push_back( MakeCorpus( "numbers", NumberLine, bytes, directory ) ) ;
+    corpora.push_back( MakeCorpus( "strings", StringLine, bytes, directory ) ) ;
+    corpora.push_back( MakeCorpus( "short_lines", ShortLine, bytes, directory ) ) ;
+    return corpora ;
+
+} // MakeCorpora()
+
+void RemoveCorpora( const std::vector<BenchmarkCorpus> & corpora ) {
+
+    for ( size_t i = 0 ; i < corpora.size() ; i++ ) {
+        remove( corpora[i].path.c_str() ) ;
+    } // for
+
+} // RemoveCorpora()
+
+void WriteJson( std::ostream & out, const BenchmarkOptions & options, size_t bytes,
+                const std::vector<BenchmarkResult> & results ) {
+
+    char date[32] = "" ;
+    time_t now = time( NULL ) ;
+    strftime( date, sizeof( date ), "%Y-%m-%dT%H:%M:%S", localtime( & now ) ) ;
+
+    out << "{\n" ;
+    out << "  \"context\": {\n" ;
+    out << "    \"date\": \"" << date << "\",\n" ;
+    out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n" ;
+    out << "    \"corpus_bytes\": " << bytes << ",\n" ;
+    out << "    \"min_time\": " << options.minSeconds << ",\n" ;
+    out << "    \"repetitions\": " << options.repetitions << "\n" ;
+    out << "  },\n" ;
+    out << "  \"benchmarks\": [" ;
+
+    for ( size_t i = 0 ; i < results.size() ; i++ ) {
+        const BenchmarkResult & result = results[i] ;
+        out << ( i == 0 ? "\n" : ",\n" ) ;
+        out << "    {\n" ;
+        out << "      \"name\": \"" << result.Name() << "\",\n" ;
+        out << "      \"version\": \"" << result.version << "\",\n" ;
+        out << "      \"benchmark\": \"" << result.benchmark << "\",\n" ;
+        out << "      \"corpus\": \"" << result.corpus << "\",\n" ;
+        out << "      \"iterations\": " << result.iterations << ",\n" ;
+        out << "      \"real_time\": " << result.seconds * 1e3 << ",\n" ;
+        out << "      \"time_unit\": \"ms\",\n" ;
+        out << "      \"bytes\": " << result.bytes << ",\n" ;
+        out << "      \"tokens\": " << result.tokens << ",\n" ;
+        out << "      \"bytes_per_second\": " << result.bytes / result.seconds << ",\n" ;
+        out << "      \"items_per_second\": " << result.tokens / result.seconds << "\n" ;
+        out << "    }" ;
+    } // for
+
+    out << "\n  ]\n}\n" ;
+
+} // WriteJson()
+
+// One row per benchmark and corpus, one MB/s column per version.
+static void WriteTable( std::ostream & out, const std::vector<BenchmarkResult> & results ) {
+
+    static const char * const kVersions[] = { "v1", "v2", "v3" } ;
+    std::vector<std::string> rows ;
+
+    for ( size_t i = 0 ; i < results.size() ; i++ ) {
+        std::string row = results[i].benchmark + "/" + results[i].corpus ;
+        bool found = false ;
+        for ( size_t j = 0 ; j < rows.size() && !found ; j++ ) {
+            found = ( rows[j] == row ) ;
+        } // for
+
+        if ( !found ) {
+            rows.push_back( row ) ;
+        } // if
+    } // for
+
+    out << std::left << std::setw( 24 ) << "MB/s" ;
+    for ( size_t v = 0 ; v < COUNT_OF( kVersions ) ; v++ ) {
+        out << std::right << std::setw( 10 ) << kVersions[v] ;
+    } // for
+
+    out << "\n" ;
+    for ( size_t r = 0 ; r < rows.size() ; r++ ) {
+        out << std::left << std::setw( 24 ) << rows[r] ;
+        for ( size_t v = 0 ; v < COUNT_OF( kVersions ) ; v++ ) {
+            std::string cell = "-" ;
+            for ( size_t i = 0 ; i < results.size() ; i++ ) {
+                if ( results[i].version == kVersions[v] &&
+                     results[i].benchmark + "/" + results[i].corpus == rows[r] ) {
+                    std::ostringstream number ;
+                    number << std::fixed << std::setprecision( 1 ) << results[i].bytes / results[i].seconds / 1e6 ;
+                    cell = number.str() ;
+                } // if
+            } // for
+
+            out << std::right << std::setw( 10 ) << cell ;
+        } // for
+
+        out << "\n" ;
+    } // for
+
+} // WriteTable()
+
+static bool GetOption( const char * arg, const char * name, std::string & value ) {
+
+    size_t length = strlen( name ) ;
+    if ( strncmp( arg, name, length ) == 0 && arg[length] == '=' ) {
+        value = arg + length + 1 ;
+        return true ;
+    } // if
+
+    return false ;
+
+} // GetOption()
+
+int main( int argc, char * argv[] ) {
+
+    BenchmarkOptions options ;
+    size_t bytes = 4 * 1024 * 1024 ;
+    std::string directory = "." ;
+    std::string outPath = "" ;
+    std::string value ;
+    bool keep = false ;
+
+    for ( int i = 1 ; i < argc ; i++ ) {
+        if ( strcmp( argv[i], "--keep" ) == 0 ) {
+            keep = true ;
+        } // if
+        else if ( GetOption( argv[i], "--bytes", value ) ) {
+            bytes = strtoul( value.c_str(), NULL, 10 ) ;
+        } // else if
+        else if ( GetOption( argv[i], "--min-time", value ) ) {
+            options.minSeconds = atof( value.c_str() ) ;
+        } // else if
+        else if ( GetOption( argv[i], "--repetitions", value ) ) {
+            options.repetitions = atoi( value.c_str() ) ;
+        } // else if
+        else if ( GetOption( argv[i], "--filter", value ) ) {
+            options.filter = value ;
+        } // else if
+        else if ( GetOption( argv[i], "--dir", value ) ) {
+            directory = value ;
+        } // else if
+        else if ( GetOption( argv[i], "--out", value ) ) {
+            outPath = value ;
+        } // else if
+        else {
+            std::cerr << "usage: " << argv[0] << " [--bytes=N] [--min-time=S] [--repetitions=N]"
+                      << " [--filter=TEXT] [--dir=PATH] [--out=FILE] [--keep]\n" ;
+            return 1 ;
+        } // else
+    } // for
+
+    if ( bytes == 0 || options.repetitions < 1 ) {
+        std::cerr << "--bytes and --repetitions must be positive\n" ;
+        return 1 ;
+    } // if
+
+    std::vector<BenchmarkCorpus> corpora = MakeCorpora( bytes, directory ) ;
+    std::vector<BenchmarkResult> results ;
+
+    BenchmarkV1( corpora, options, results ) ;
+    BenchmarkV2( corpora, options, results ) ;
+    BenchmarkV3( corpora, options, results ) ;
+
+    if ( !keep ) {
+        RemoveCorpora( corpora ) ;
+    } // if
+
+    if ( outPath.empty() ) {
+        WriteJson( std::cout, options, bytes, results ) ;
+    } // if
+    else {
+        std::ofstream outFile( outPath.c_str(), std::ios::out ) ;
+        WriteJson( outFile, options, bytes, results ) ;
+    } // else
+
+    WriteTable( std::cerr, results ) ;
+    return 0 ;
+
+} // main()
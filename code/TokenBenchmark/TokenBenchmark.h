@@ -0,0 +1,190 @@
+# ifndef TOKEN_BENCHMARK_H_INCLUDED
+# define TOKEN_BENCHMARK_H_INCLUDED
+
+# include <iostream>
+# include <fstream>
+# include <streambuf>
+# include <string>
+# include <vector>
+# include <chrono>
+# include <stddef.h>
+
+/* TokenBenchmark : times every version of TokenProcessor on the same inputs */
+
+// One synthetic input. The lines are fed to CutLine(), the file at "path" to CutFile().
+struct BenchmarkCorpus {
+    std::string name ;
+    std::string path ;
+    std::vector<std::string> lines ;
+    size_t bytes ;
+    BenchmarkCorpus() : bytes( 0 ) {} // constructor
+} ; // struct BenchmarkCorpus
+
+struct BenchmarkOptions {
+    double minSeconds ;     // each repetition runs at least this long
+    int repetitions ;       // the fastest repetition is reported
+    std::string filter ;    // only names containing this run
+    BenchmarkOptions() : minSeconds( 0.5 ), repetitions( 3 ), filter( "" ) {} // constructor
+} ; // struct BenchmarkOptions
+
+struct BenchmarkResult {
+    std::string version ;
+    std::string benchmark ;
+    std::string corpus ;
+    size_t iterations ;
+    double seconds ;        // per iteration
+    size_t bytes ;          // per iteration
+    size_t tokens ;         // per iteration
+    BenchmarkResult() : iterations( 0 ), seconds( 0.0 ), bytes( 0 ), tokens( 0 ) {} // constructor
+    std::string Name() const { return version + "/" + benchmark + "/" + corpus ; }
+} ; // struct BenchmarkResult
+
+// Swallows what Output() writes to std::cout while it is timed.
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow( int ch ) { return ch ; }
+    std::streamsize xsputn( const char *, std::streamsize count ) { return count ; }
+} ; // class NullBuffer
+
+std::vector<BenchmarkCorpus> MakeCorpora( size_t bytes, const std::string & directory ) ;
+void RemoveCorpora( const std::vector<BenchmarkCorpus> & corpora ) ;
+void WriteJson( std::ostream & out, const BenchmarkOptions & options, size_t bytes,
+                const std::vector<BenchmarkResult> & results ) ;
+
+// Each version lives in its own translation unit, since the headers share names.
+void BenchmarkV1( const std::vector<BenchmarkCorpus> & corpora, const BenchmarkOptions & options,
+                  std::vector<BenchmarkResult> & results ) ;
+void BenchmarkV2( const std::vector<BenchmarkCorpus> & corpora, const BenchmarkOptions & options,
+                  std::vector<BenchmarkResult> & results ) ;
+void BenchmarkV3( const std::vector<BenchmarkCorpus> & corpora, const BenchmarkOptions & options,
+                  std::vector<BenchmarkResult> & results ) ;
+
+/* The cases. Each one runs its body until minSeconds pass, "repetitions" times. */
+
+template <class Processor>
+struct CutLineCase {
+    static const char * Name() { return "CutLine" ; }
+    static void Prepare( Processor &, const BenchmarkCorpus & ) {}
+    static void Run( Processor & tp, const BenchmarkCorpus & corpus ) {
+        tp.Clear() ;
+        for ( size_t i = 0 ; i < corpus.lines.size() ; i++ ) {
+            tp.CutLine( corpus.lines[i] ) ;
+        } // for
+    } // Run()
+} ; // struct CutLineCase
+
+template <class Processor>
+struct CutFileCase {
+    static const char * Name() { return "CutFile" ; }
+    static void Prepare( Processor &, const BenchmarkCorpus & ) {}
+    static void Run( Processor & tp, const BenchmarkCorpus & corpus ) {
+        std::fstream inFile( corpus.path.c_str(), std::ios::in ) ;
+        tp.Clear() ;
+        tp.CutFile( inFile ) ;
+    } // Run()
+} ; // struct CutFileCase
+
+template <class Processor, class Data>
+struct GetTokenCase {
+    static const char * Name() { return "GetToken" ; }
+    static void Prepare( Processor & tp, const BenchmarkCorpus & corpus ) {
+        CutFileCase<Processor>::Run( tp, corpus ) ;
+    } // Prepare()
+    static void Run( Processor & tp, const BenchmarkCorpus & ) {
+        Data data ;
+        tp.BackToBeginning() ;
+        while ( tp.GetToken( data ) ) {
+        } // while
+    } // Run()
+} ; // struct GetTokenCase
+
+template <class Processor>
+struct OutputCase {
+    static const char * Name() { return "Output" ; }
+    static void Prepare( Processor & tp, const BenchmarkCorpus & corpus ) {
+        CutFileCase<Processor>::Run( tp, corpus ) ;
+    } // Prepare()
+    static void Run( Processor & tp, const BenchmarkCorpus & ) {
+        tp.Output( true, true ) ;
+    } // Run()
+} ; // struct OutputCase
+
+template <class Processor, class Data>
+size_t CountTokens( const BenchmarkCorpus & corpus ) {
+
+    Processor tp ;
+    Data data ;
+    size_t count = 0 ;
+
+    CutFileCase<Processor>::Run( tp, corpus ) ;
+    while ( tp.GetToken( data ) ) {
+        count++ ;
+    } // while
+
+    return count ;
+
+} // CountTokens()
+
+template <class Case, class Processor>
+void RunCase( const char * version, const BenchmarkCorpus & corpus, size_t tokens,
+              const BenchmarkOptions & options, std::vector<BenchmarkResult> & results ) {
+
+    typedef std::chrono::steady_clock Clock ;
+
+    BenchmarkResult result ;
+    result.version = version ;
+    result.benchmark = Case::Name() ;
+    result.corpus = corpus.name ;
+    result.bytes = corpus.bytes ;
+    result.tokens = tokens ;
+
+    if ( result.Name().find( options.filter ) == std::string::npos ) {
+        return ;
+    } // if
+
+    std::cerr << result.Name() << " ..." << std::endl ;
+
+    NullBuffer nullBuffer ;
+    std::streambuf * coutBuffer = std::cout.rdbuf( & nullBuffer ) ;
+
+    Processor tp ;
+    Case::Prepare( tp, corpus ) ;
+    Case::Run( tp, corpus ) ; // warm up
+
+    for ( int repetition = 0 ; repetition < options.repetitions ; repetition++ ) {
+        size_t iterations = 0 ;
+        double elapsed = 0.0 ;
+        Clock::time_point start = Clock::now() ;
+        while ( iterations == 0 || elapsed < options.minSeconds ) {
+            Case::Run( tp, corpus ) ;
+            iterations++ ;
+            elapsed = std::chrono::duration<double>( Clock::now() - start ).count() ;
+        } // while
+
+        double seconds = elapsed / iterations ;
+        if ( result.iterations == 0 || seconds < result.seconds ) {
+            result.iterations = iterations ;
+            result.seconds = seconds ;
+        } // if
+    } // for
+
+    std::cout.rdbuf( coutBuffer ) ;
+    results.push_back( result ) ;
+
+} // RunCase()
+
+template <class Processor, class Data>
+void RunBenchmarks( const char * version, const std::vector<BenchmarkCorpus> & corpora,
+                    const BenchmarkOptions & options, std::vector<BenchmarkResult> & results ) {
+
+    for ( size_t i = 0 ; i < corpora.size() ; i++ ) {
+        size_t tokens = CountTokens<Processor, Data>( corpora[i] ) ;
+        RunCase< CutLineCase<Processor>, Processor >( version, corpora[i], tokens, options, results ) ;
+        RunCase< CutFileCase<Processor>, Processor >( version, corpora[i], tokens, options, results ) ;
+        RunCase< GetTokenCase<Processor, Data>, Processor >( version, corpora[i], tokens, options, results ) ;
+        RunCase< OutputCase<Processor>, Processor >( version, corpora[i], tokens, options, results ) ;
+    } // for
+
+} // RunBenchmarks()
+
+# endif // TOKEN_BENCHMARK_H_INCLUDED
@@ -0,0 +1,14 @@
+﻿# include "TokenBenchmark.h"
+
+// v1 and v3 use the same names for different classes, so the ones of v1 are renamed here;
+// the header is included as it is, with its own includes.
+# define TokenProcessor TokenProcessorV1
+# define TokenData TokenDataV1
+# include "../TokenProcessor_v1/TokenProcessor.h"
+
+void BenchmarkV1( const std::vector<BenchmarkCorpus> & corpora, const BenchmarkOptions & options,
+                  std::vector<BenchmarkResult> & results ) {
+
+    RunBenchmarks<TokenProcessorV1, TokenDataV1>( "v1", corpora, options, results ) ;
+
+} // BenchmarkV1()
@@ -0,0 +1,14 @@
+﻿# include "TokenBenchmark.h"
+
+// v2 and v3 use the same names for different classes, so the ones of v2 are renamed here;
+// the header is included as it is, with its own includes.
+# define TokenProcessor TokenProcessorV2
+# define TokenData TokenDataV2
+# include "../TokenProcessor_v2/TokenProcessor.h"
+
+void BenchmarkV2( const std::vector<BenchmarkCorpus> & corpora, const BenchmarkOptions & options,
+                  std::vector<BenchmarkResult> & results ) {
+
+    RunBenchmarks<TokenProcessorV2, TokenDataV2>( "v2", corpora, options, results ) ;
+
+} // BenchmarkV2()
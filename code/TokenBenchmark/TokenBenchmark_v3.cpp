@@ -0,0 +1,10 @@
+﻿# include "TokenBenchmark.h"
+
+# include "../TokenProcessor_v3/TokenProcessor.h"
+
+void BenchmarkV3( const std::vector<BenchmarkCorpus> & corpora, const BenchmarkOptions & options,
+                  std::vector<BenchmarkResult> & results ) {
+
+    RunBenchmarks<TokenProcessor, TokenData>( "v3", corpora, options, results ) ;
+
+} // BenchmarkV3()
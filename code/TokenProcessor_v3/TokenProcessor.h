@@ -4,8 +4,31 @@
 # include <iostream>
 # include <fstream>
 # include <string>
+# include <string_view>
 # include <vector>
+# include <unordered_map>
+# include <iterator>
+# include <algorithm>
+# include <cstdio>
+# include <charconv>
+# include <thread>
+# include <atomic>
+# include <chrono>
+# include <stdint.h>
 # include <stdlib.h>
+# include <math.h>
+# include <string.h>
+# include <errno.h>
+
+# if defined( __unix__ ) || defined( __APPLE__ )
+# define TOKEN_PROCESSOR_HAS_MMAP 1
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+# else
+# define TOKEN_PROCESSOR_HAS_MMAP 0
+# endif
 
 /* TokenProcessor Version 3 */
 
@@ -18,528 +41,4572 @@ typedef int TokenType ;
 # define DELIMITER 4
 # define STRING 5
 # define CHAR 6
+# define COMMENT 7
 
-struct TokenData {
-    std::string token ;
-    int iValue ;
-    double dValue ;
-    std::string contents ;
-    TokenType type ;
-    TokenData() : token( "" ), iValue( 0 ), dValue( 0.0 ), contents( "" ), type( UNKNOWN ) {} // constructor
-    TokenData( std::string tkn, int i, double d, std::string cnt, TokenType t ) :
-        token( tkn ), iValue( i ), dValue( d ), contents( cnt ), type( t ) {} // constructor
-} ; // struct TokenData
+# define COMMENTS_OFF 0 // "//" and "/*" are delimiters
+# define COMMENTS_SKIP 1 // comments are dropped
+# define COMMENTS_KEEP 2 // each comment is one COMMENT token
 
-class TokenProcessor {
+# define NUMBERS_PLAIN 0 // digits with at most one '.'
+# define NUMBERS_C 1 // C and C++ literals: prefixes, exponents, suffixes and digit separators
 
-private:
+# define PENDING_NONE 0
+# define PENDING_BLOCK_COMMENT 1
+# define PENDING_LINE_COMMENT 2 // ended with a continuation
+# define PENDING_STRING 3 // ended with a continuation
+# define PENDING_CHAR 4
 
-    std::string mDelimitersList ;
-    std::vector<std::string> mOriginalContent ;
+typedef unsigned char CharClass ;
 
-    std::vector< std::vector<TokenData> > mTokenBox ;
-    size_t mRowIndex ;
-    size_t mColumnIndex ;
+# define CLASS_WHITE 0x01
+# define CLASS_IDENTIFIER_START 0x02
+# define CLASS_IDENTIFIER 0x04 // may continue an identifier
+# define CLASS_DIGIT 0x08
+# define CLASS_DELIMITER 0x10
 
-    bool IsWhite( char ch ) ;
-    bool IsLetter( char ch ) ;
-    bool IsDigit( char ch ) ;
-    bool IsDelimiter( char ch ) ;
+struct CharClassTable {
+    CharClass flags[256] ;
+} ; // struct CharClassTable
 
-    char ChangeChar( char ch ) ;
+constexpr CharClassTable MakeDefaultCharClassTable() {
 
-    TokenData GetLetterToken( char firstChar, size_t & index, std::string & source ) ;
-    TokenData GetNumberToken( char firstChar, size_t & index, std::string & source, bool beginWithInteger ) ;
-    TokenData GetDelimiterToken( char firstChar, size_t & index, std::string & source ) ;
-    TokenData GetStringToken( char boundaryChar, size_t & index, std::string & source, TokenType type ) ;
+    CharClassTable table = {} ;
+    const char * delimiters = "!#$%&()*+,-./:;<=>?@[\\]^`{|}~" ; // no _ " '
 
-public:
+    table.flags[( unsigned char ) ' '] = table.flags[( unsigned char ) '\t'] = CLASS_WHITE ;
+    table.flags[( unsigned char ) '\n'] = table.flags[( unsigned char ) '\r'] = CLASS_WHITE ;
 
-    TokenProcessor() ; // constructor
+    for ( int ch = 'a' ; ch <= 'z' ; ch++ ) {
+        table.flags[ch] = table.flags[ch - 'a' + 'A'] = CLASS_IDENTIFIER_START | CLASS_IDENTIFIER ;
+    } // for
 
-    void CutLine( std::string str ) ;
-    void CutFile( std::fstream & inFile ) ;
+    table.flags[( unsigned char ) '_'] = CLASS_IDENTIFIER_START | CLASS_IDENTIFIER ;
 
-    bool GetToken( TokenData & token ) ;
-    bool GetToken( TokenData & token, int times ) ;
-    bool PeekToken( TokenData & token ) ;
+    for ( int ch = '0' ; ch <= '9' ; ch++ ) {
+        table.flags[ch] = CLASS_DIGIT | CLASS_IDENTIFIER ;
+    } // for
 
-    void Output( bool setBracket, bool setBoundary ) ;
-    void OutputOriginal( bool setBoundary ) ;
+    for ( size_t i = 0 ; delimiters[i] != '\0' ; i++ ) {
+        table.flags[( unsigned char ) delimiters[i]] = CLASS_DELIMITER ;
+    } // for
 
-    void Clear() ;
-    void BackToBeginning() ;
+    return table ;
 
-} ; // class TokenProcessor
+} // MakeDefaultCharClassTable()
 
-TokenProcessor::TokenProcessor() { // constructor
+constexpr CharClassTable kDefaultCharClasses = MakeDefaultCharClassTable() ;
 
-    mDelimitersList = "!#$%&()*+,-./:;<=>?@[\\]^`{|}~" ; // no _ " '
+# define MAX_OPERATOR_STATES 128
+# define MAX_OPERATOR_CHARS 48
 
-    mRowIndex = mColumnIndex = 0 ;
+// A trie of the multi-character delimiters, matched longest first.
+// State 0 is the root and also means "no transition"; column 0 is every character
+// that is not used by any operator.
+struct OperatorTable {
+    unsigned char column[256] ;
+    unsigned char next[MAX_OPERATOR_STATES][MAX_OPERATOR_CHARS] ;
+    bool accept[MAX_OPERATOR_STATES] ;
+    int states ;
+    int columns ;
+} ; // struct OperatorTable
 
-} // TokenProcessor::TokenProcessor()
+constexpr bool InsertOperator( OperatorTable & table, const char * op, size_t length ) {
 
-void TokenProcessor::CutLine( std::string str ) {
+    int newStates = 0, newColumns = 0, state = 0 ;
 
-    mOriginalContent.push_back( str ) ;
+    for ( size_t i = 0 ; i < length ; i++ ) { // count what is missing before changing anything
 
-    std::vector<TokenData> tokenList ;
+        unsigned char ch = ( unsigned char ) op[i] ;
+        bool seen = false ;
 
-    for ( size_t i = 0 ; i < str.length() ; i++ ) {
+        for ( size_t j = 0 ; j < i && !seen ; j++ ) {
+            seen = ( ( unsigned char ) op[j] == ch ) ;
+        } // for
 
-        if ( IsWhite( str[i] ) ) {
-            ;
+        if ( table.column[ch] == 0 && !seen ) {
+            newColumns++ ;
+        } // if
+
+        if ( state != 0 || i == 0 ) {
+            state = ( table.column[ch] != 0 ? table.next[state][table.column[ch]] : 0 ) ;
+        } // if
+
+        if ( state == 0 ) {
+            newStates++ ;
         } // if
-        else if ( str[i] == '_' || IsLetter( str[i] ) ) {
-            tokenList.push_back( GetLetterToken( str[i], i, str ) ) ;
-        } // else if
-        else if ( IsDigit( str[i] ) ) {
-            tokenList.push_back( GetNumberToken( str[i], i, str, true ) ) ;
-        } // else if
-        else if ( str[i] == '\"' ) {
-            tokenList.push_back( GetStringToken( str[i], i, str, STRING ) ) ;
-        } // else if
-        else if ( str[i] == '\'' ) {
-            tokenList.push_back( GetStringToken( str[i], i, str, CHAR ) ) ;
-        } // else if
-        else { // IsDelimiter( str[i] )
-            tokenList.push_back( GetDelimiterToken( str[i], i, str ) ) ;
-        } // else
 
     } // for
 
-    if ( tokenList.size() != 0 ) {
-        mTokenBox.push_back( tokenList ) ;
-        tokenList.clear() ;
+    if ( length == 0 || table.states + newStates > MAX_OPERATOR_STATES ||
+         table.columns + newColumns > MAX_OPERATOR_CHARS ) {
+        return false ;
     } // if
 
-} // TokenProcessor::CutLine()
+    state = 0 ;
 
-void TokenProcessor::CutFile( std::fstream & inFile ) {
+    for ( size_t i = 0 ; i < length ; i++ ) {
 
-    std::string line = "" ;
+        unsigned char ch = ( unsigned char ) op[i] ;
 
-    while ( getline( inFile, line ) ) {
-        CutLine( line ) ;
-    } // while
+        if ( table.column[ch] == 0 ) {
+            table.column[ch] = ( unsigned char ) table.columns++ ;
+        } // if
 
-} // TokenProcessor::CutFile()
+        if ( table.next[state][table.column[ch]] == 0 ) {
+            table.next[state][table.column[ch]] = ( unsigned char ) table.states++ ;
+        } // if
+
+        state = table.next[state][table.column[ch]] ;
+
+    } // for
+
+    table.accept[state] = true ;
+    return true ;
+
+} // InsertOperator()
+
+constexpr OperatorTable MakeOperatorTable( const char * const * operators ) {
+
+    OperatorTable table = {} ;
+    table.states = table.columns = 1 ;
 
-TokenData TokenProcessor::GetLetterToken( char firstChar, size_t & index, std::string & source ) {
+    for ( size_t i = 0 ; operators[i] != NULL ; i++ ) {
 
-    std::string token = "" ;
-    token += firstChar ;
+        size_t length = 0 ;
+
+        while ( operators[i][length] != '\0' ) {
+            length++ ;
+        } // while
+
+        InsertOperator( table, operators[i], length ) ;
 
-    for ( index++ ; index < source.length() &&
-                    ( IsLetter( source[index] ) || IsDigit( source[index] ) || source[index] == '_' ) ;
-          index++ ) {
-        token += source[index] ;
     } // for
 
-    if ( index < source.length() && ( !IsWhite( source[index] ) ) ) {
-        index-- ;
-    } // if
+    return table ;
 
-    return TokenData( token, 0, 0.0, "", IDENTIFIER ) ;
+} // MakeOperatorTable()
 
-} // TokenProcessor::GetLetterToken()
+constexpr const char * kDefaultOperators[] = {
+    "+=", "++", "-=", "--", "->", "*=", "*/", "/=", "//", "/*", "%=", "<=", "<<",
+    ">=", ">>", "!=", "==", "&&", "&=", "||", "|=", "::", "##", ".*", "^=",
+    "->*", "<<=", ">>=", NULL
+} ; // kDefaultOperators
 
-TokenData TokenProcessor::GetNumberToken( char firstChar, size_t & index, std::string & source, bool beginWithInteger ) {
+constexpr OperatorTable kDefaultOperatorTable = MakeOperatorTable( kDefaultOperators ) ;
 
-    std::string token = "" ;
-    bool isInt = beginWithInteger, running = true ;
+constexpr const char * kNoOperators[] = { NULL } ;
 
-    token += firstChar ;
-    index++ ;
+constexpr OperatorTable kNoOperatorTable = MakeOperatorTable( kNoOperators ) ;
+
+// What the character after a '\\' in a STRING or CHAR stands for.
+struct EscapeTable {
+    char to[256] ;
+} ; // struct EscapeTable
+
+constexpr EscapeTable MakeDefaultEscapeTable() {
+
+    EscapeTable table = {} ;
+
+    for ( int ch = 0 ; ch < 256 ; ch++ ) {
+        table.to[ch] = ( char ) ch ; // any other character stands for itself
+    } // for
+
+    table.to[( unsigned char ) 'n'] = '\n' ;
+    table.to[( unsigned char ) 'r'] = '\r' ;
+    table.to[( unsigned char ) 't'] = '\t' ;
+    table.to[( unsigned char ) 'a'] = '\a' ;
+    table.to[( unsigned char ) 'b'] = '\b' ;
+    table.to[( unsigned char ) 'f'] = '\f' ;
+    table.to[( unsigned char ) 'v'] = '\v' ;
+
+    return table ;
+
+} // MakeDefaultEscapeTable()
+
+constexpr EscapeTable kDefaultEscapes = MakeDefaultEscapeTable() ;
+
+# define NO_QUOTE -1
+# define MODE_RUNTIME -1 // the mode is chosen with SetCommentMode() or SetNumberMode()
+
+// The classes of "table" that include every character of their default class. A scan kernel
+// stops at the end of a default-class run and the table finishes the run, so it can be used for them.
+constexpr CharClass ScanClasses( const CharClassTable & table ) {
+
+    CharClass classes = CLASS_WHITE | CLASS_IDENTIFIER | CLASS_DIGIT ;
+
+    for ( int ch = 0 ; ch < 256 ; ch++ ) {
+        classes = ( CharClass ) ( classes & ~( kDefaultCharClasses.flags[ch] & ~table.flags[ch] ) ) ;
+    } // for
+
+    return classes ;
+
+} // ScanClasses()
+
+// The rules a BasicTokenProcessor is compiled with, all constexpr data:
+//   kCharClasses and kOperators are read directly until SetCharClass() or AddOperator() change a copy,
+//   kEscapes is used in STRING and CHAR, kStringQuote and kCharQuote begin them (NO_QUOTE for none),
+//   kDoubles lets a '.' go on after the digits of a number, and kLeadingDot lets ".5" begin one,
+//   kCommentMode and kNumberMode fix the modes, or leave them to the setters with MODE_RUNTIME.
+// A rule that is off costs nothing, its branches are compiled away.
+struct TokenPolicyV3 {
+    static constexpr CharClassTable kCharClasses = kDefaultCharClasses ;
+    static constexpr OperatorTable kOperators = kDefaultOperatorTable ;
+    static constexpr EscapeTable kEscapes = kDefaultEscapes ;
+    static constexpr int kStringQuote = '\"' ;
+    static constexpr int kCharQuote = '\'' ;
+    static constexpr bool kDoubles = true ;
+    static constexpr bool kLeadingDot = true ;
+    static constexpr int kCommentMode = MODE_RUNTIME ;
+    static constexpr int kNumberMode = MODE_RUNTIME ;
+} ; // struct TokenPolicyV3
+
+// The tokens of TokenProcessor_v2: no STRING, CHAR or COMMENT, quotes are delimiters.
+struct TokenPolicyV2 : TokenPolicyV3 {
+    static constexpr int kStringQuote = NO_QUOTE ;
+    static constexpr int kCharQuote = NO_QUOTE ;
+    static constexpr int kCommentMode = COMMENTS_OFF ;
+    static constexpr int kNumberMode = NUMBERS_PLAIN ;
+} ; // struct TokenPolicyV2
+
+// The tokens of TokenProcessor_v1: only identifiers, INTEGERs and one-character delimiters.
+struct TokenPolicyV1 : TokenPolicyV2 {
+    static constexpr OperatorTable kOperators = kNoOperatorTable ;
+    static constexpr bool kDoubles = false ;
+    static constexpr bool kLeadingDot = false ;
+} ; // struct TokenPolicyV1
+
+# define NO_SYMBOL 0xFFFFFFFFu
+
+# define NUMBER_OVERFLOW 0x01 // too large: an INTEGER is INT64_MAX (-1 if it may be unsigned), a DOUBLE infinity
+# define NUMBER_UNDERFLOW 0x02 // a DOUBLE too small to be told from 0
+# define NUMBER_MALFORMED 0x04 // NUMBERS_C only: a bad digit or suffix, or a hex DOUBLE without 'p'
+# define NUMBER_UNSIGNED 0x08 // NUMBERS_C suffixes
+# define NUMBER_LONG 0x10
+# define NUMBER_LONG_LONG 0x20
+# define NUMBER_FLOAT 0x40
+# define NUMBER_DEFERRED 0x100 // only in the token box, the value is converted when it is read
+# define NUMBER_C_GRAMMAR 0x200 // only in the token box, a deferred number cut with NUMBERS_C
+
+// "offset" is the byte offset of the token in the whole input, "line" and "column" count from 0,
+// and "column" is in bytes.
+struct TokenData {
+    std::string token ;
+    int64_t iValue ;
+    double dValue ;
+    std::string contents ;
+    TokenType type ;
+    size_t offset ;
+    size_t line ;
+    size_t column ;
+    uint32_t symbol ; // id of an IDENTIFIER while interning, see SymbolTable, or NO_SYMBOL
+    int numberFlags ; // NUMBER_OVERFLOW or NUMBER_UNDERFLOW when the value of a number is not exact
+    TokenData() : token( "" ), iValue( 0 ), dValue( 0.0 ), contents( "" ), type( UNKNOWN ),
+                  offset( 0 ), line( 0 ), column( 0 ), symbol( NO_SYMBOL ), numberFlags( 0 ) {} // constructor
+    TokenData( std::string tkn, int64_t i, double d, std::string cnt, TokenType t ) :
+        token( tkn ), iValue( i ), dValue( d ), contents( cnt ), type( t ), offset( 0 ), line( 0 ), column( 0 ),
+        symbol( NO_SYMBOL ), numberFlags( 0 ) {} // constructor
+} ; // struct TokenData
+
+// Same fields as TokenData, but "token" and "contents" point into the processor.
+// A view stays valid until the next CutLine(), CutFile(), CutMappedFile() or Clear(),
+// or, for a stream, until the next GetToken() or PeekToken() that has to read more.
+struct TokenView {
+    std::string_view token ;
+    int64_t iValue ;
+    double dValue ;
+    std::string_view contents ;
+    TokenType type ;
+    size_t offset ;
+    size_t line ;
+    size_t column ;
+    uint32_t symbol ;
+    int numberFlags ;
+    TokenView() : token(), iValue( 0 ), dValue( 0.0 ), contents(), type( UNKNOWN ),
+                  offset( 0 ), line( 0 ), column( 0 ), symbol( NO_SYMBOL ), numberFlags( 0 ) {} // constructor
+} ; // struct TokenView
+
+// A token kept as a range of the source buffer.
+// "contents" of a STRING or CHAR is a range of the source buffer too,
+// unless it had escapes and was decoded into the arena.
+// Only a DOUBLE has "dValue", the other types have "iValue", 0 unless an INTEGER.
+struct TokenRecord {
+    size_t offset ;
+    size_t length ;
+    union {
+        int64_t iValue ;
+        double dValue ;
+    } ; // union
+    uint32_t line ;
+    uint32_t numberFlags ;
+    size_t contentsOffset ;
+    size_t contentsLength ;
+    const char * decodedContents ; // NULL unless decoded
+    TokenType type ;
+    uint32_t symbol ;
+    TokenRecord( size_t off, size_t len, int64_t i, double d, TokenType t ) :
+        offset( off ), length( len ), iValue( i ), line( 0 ), numberFlags( 0 ),
+        contentsOffset( 0 ), contentsLength( 0 ), decodedContents( NULL ), type( t ), symbol( NO_SYMBOL ) { // constructor
+        if ( t == DOUBLE ) {
+            dValue = d ;
+        } // if
+    } // TokenRecord()
+} ; // struct TokenRecord
+
+// 0 to 15 for a digit of any base up to 16, 99 for anything else.
+inline int DigitValue( char ch ) {
+
+    if ( ch >= '0' && ch <= '9' ) {
+        return ch - '0' ;
+    } // if
+    else if ( ( ch | 0x20 ) >= 'a' && ( ch | 0x20 ) <= 'f' ) {
+        return ( ch | 0x20 ) - 'a' + 10 ;
+    } // else if
+    else {
+        return 99 ;
+    } // else
+
+} // DigitValue()
+
+// Whether a floating literal that std::from_chars() finds out of range is too large rather than too
+// small: "text" is the digits in "base" (10 or 16) with a '.' and then maybe an exponent.
+inline bool NumberIsLarge( const char * text, const char * end, int base ) {
 
-    while ( index < source.length() && running ) {
+    long scale = 0, exponent = 0 ; // the digits before the first one not 0, counted from the '.'
+    bool point = false, nonzero = false, negative = false ;
+    const char * p = text ;
 
-        if ( IsDigit( source[index] ) ) {
-            token += source[index++] ;
+    for ( ; p < end && ( *p == '.' || DigitValue( *p ) < base ) ; p++ ) {
+        if ( *p == '.' ) {
+            point = true ;
         } // if
-        else if ( source[index] == '.' ) {
-            if ( isInt ) {
-                isInt = false ;
-                token += source[index++] ;
-            } // if
-            else {
-                running = false ;
-            } // else
+        else if ( !point && ( nonzero || *p != '0' ) ) {
+            nonzero = true ;
+            scale++ ;
+        } // else if
+        else if ( point && !nonzero ) {
+            nonzero = ( *p != '0' ) ;
+            scale -= ( nonzero ? 0 : 1 ) ;
         } // else if
         else {
-            running = false ;
+            ;
         } // else
-        
-    } // while
+    } // for
 
-    if ( index < source.length() && ( !IsWhite( source[index] ) ) ) {
-        index-- ;
+    if ( p < end && ( ( *p | 0x20 ) == 'e' || ( *p | 0x20 ) == 'p' ) ) {
+        p++ ;
+        negative = ( p < end && *p == '-' ) ;
+        p += ( p < end && ( *p == '-' || *p == '+' ) ? 1 : 0 ) ;
+        for ( ; p < end && *p >= '0' && *p <= '9' && exponent < 100000000 ; p++ ) {
+            exponent = exponent * 10 + ( *p - '0' ) ;
+        } // for
     } // if
 
-    return ( isInt ? TokenData( token, atoi( token.c_str() ), 0.0, "", INTEGER ) :
-                     TokenData( token, 0, atof( token.c_str() ), "", DOUBLE ) ) ;
+    return ( base == 16 ? 4 * scale : scale ) + ( negative ? -exponent : exponent ) > 0 ;
 
-} // TokenProcessor::GetNumberToken()
+} // NumberIsLarge()
 
-TokenData TokenProcessor::GetStringToken( char boundaryChar, size_t & index, std::string & source, TokenType type ) {
+// Converts the text of an INTEGER or a DOUBLE the way atoi() and atof() read it, but to 64 bits,
+// whatever the locale, and with NUMBER_OVERFLOW or NUMBER_UNDERFLOW instead of a wrong value.
+// Sets "iValue" of an INTEGER or "dValue" of a DOUBLE and returns the flags.
+inline int ParseNumber( const char * begin, const char * end, TokenType type, int64_t & iValue, double & dValue ) {
 
-    std::string token = "", contents = "" ;
-    token += boundaryChar ; // left boundary
+    if ( type == DOUBLE ) {
 
-    for ( index++ ; index < source.length() && source[index] != boundaryChar ; index++ ) {
+        std::from_chars_result result = std::from_chars( begin, end, dValue ) ;
 
-        if ( source[index] == '\\' ) {
+        if ( result.ec == std::errc::result_out_of_range ) {
 
-            token += source[index] ;
+            bool large = NumberIsLarge( begin, end, 10 ) ;
 
-            if ( index + 1 < source.length() ) {
-                index++ ;
-                token += source[index] ;
-                contents += ChangeChar( source[index] ) ;
-            } // if
-            else {
-                contents += source[index] ;
-            } // else
+            dValue = ( large ? HUGE_VAL : 0.0 ) ;
+            return ( large ? NUMBER_OVERFLOW : NUMBER_UNDERFLOW ) ;
 
         } // if
+        else if ( result.ec != std::errc() ) {
+            dValue = 0.0 ;
+        } // else if
         else {
-            token += source[index] ;
-            contents += source[index] ;
+            ;
         } // else
 
-    } // for
+        return 0 ;
 
-    if ( index < source.length() ) {
-        token += source[index] ; // right boundary
     } // if
-    else {
-        ; // right boundary does not exist
-    } // else
-
-    return TokenData( token, 0, 0.0, contents, type ) ;
 
-} // TokenProcessor::GetStringToken()
+    uint64_t value = 0 ;
+    const char * p = begin ;
 
-TokenData TokenProcessor::GetDelimiterToken( char firstChar, size_t & index, std::string & source ) {
+    for ( const char * safeEnd = ( end - begin > 18 ? begin + 18 : end ) ; p < safeEnd && *p >= '0' && *p <= '9' ; p++ ) {
+        value = value * 10 + ( unsigned ) ( *p - '0' ) ; // 18 digits always fit
+    } // for
 
-    std::string token = "" ;
-    token += firstChar ;
+    for ( ; p < end && *p >= '0' && *p <= '9' ; p++ ) {
 
-    if ( firstChar == '+' ) {
+        unsigned digit = ( unsigned ) ( *p - '0' ) ;
 
-        if ( index + 1 < source.length() && ( source[index + 1] == '=' || source[index + 1] == '+' ) ) {
-            token += source[++index] ; // += ++
+        if ( value > ( ( uint64_t ) INT64_MAX - digit ) / 10 ) {
+            iValue = INT64_MAX ;
+            return NUMBER_OVERFLOW ;
         } // if
 
-    } // if
-    else if ( firstChar == '-' ) {
+        value = value * 10 + digit ;
 
-        if ( index + 1 < source.length() ) {
-            if ( source[index + 1] == '=' || source[index + 1] == '-' ) {
-                token += source[++index] ; // -= --
-            } // if
-            else if ( source[index + 1] == '>' ) {
-                token += source[++index] ; // ->
-                if ( index + 1 < source.length() && source[index + 1] == '*' ) {
-                    token += source[++index] ; // ->*
-                } // if
-            } // else if
-            else {
-                ;
-            } // else            
-        } // if
+    } // for
 
-    } // else if
-    else if ( firstChar == '*' ) {
+    iValue = ( int64_t ) value ;
+    return 0 ;
 
-        if ( index + 1 < source.length() && ( source[index + 1] == '=' || source[index + 1] == '/' ) ) {
-            token += source[++index] ; // *= */
-        } // if
+} // ParseNumber()
 
-    } // else if
-    else if ( firstChar == '/' ) {
+// The end of the digits in "base" from source[index], and of the '\'' separators between them.
+inline size_t ScanCDigits( const char * source, size_t index, size_t length, int base ) {
 
-        if ( index + 1 < source.length() && ( source[index + 1] == '=' || source[index + 1] == '/' || source[index + 1] == '*' ) ) {
-            token += source[++index] ; // /= // /*
+    for ( ; index < length ; index++ ) {
+        if ( DigitValue( source[index] ) >= base &&
+             !( source[index] == '\'' && index > 0 && DigitValue( source[index - 1] ) < base &&
+                index + 1 < length && DigitValue( source[index + 1] ) < base ) ) {
+            break ;
         } // if
+    } // for
 
-    } // else if
-    else if ( firstChar == '%' ) {
+    return index ;
 
-        if ( index + 1 < source.length() && source[index + 1] == '=' ) {
-            token += source[++index] ; // %=
-        } // if
+} // ScanCDigits()
 
-    } // else if
-    else if ( firstChar == '<' ) {
+// The flags of the suffix [begin, end) of a C literal, or -1 if it is not a suffix of the type.
+inline int CNumberSuffix( const char * begin, const char * end, TokenType type ) {
 
-        if ( index + 1 < source.length() ) {
-            if ( source[index + 1] == '=' ) {
-                token += source[++index] ; // <=
-            } // if
-            else if ( source[index + 1] == '<' ) {
-                token += source[++index] ; // <<
-                if ( index + 1 < source.length() && source[index + 1] == '=' ) {
-                    token += source[++index] ; // <<=
-                } // if
-            } // else if
-            else {
-                ;
-            } // else
-        } // if
+    int flags = 0 ;
+    const char * p = begin ;
 
-    } // else if
-    else if ( firstChar == '>' ) {
+    if ( type == DOUBLE ) {
+        if ( end - p == 1 && ( *p | 0x20 ) == 'f' ) {
+            return NUMBER_FLOAT ;
+        } // if
+        else if ( end - p == 1 && ( *p | 0x20 ) == 'l' ) {
+            return NUMBER_LONG ;
+        } // else if
+        else {
+            return ( p == end ? 0 : -1 ) ;
+        } // else
+    } // if
 
-        if ( index + 1 < source.length() ) {
-            if ( source[index + 1] == '=' ) {
-                token += source[++index] ; // >=
-            } // if
-            else if ( source[index + 1] == '>' ) {
-                token += source[++index] ; // >>
-                if ( index + 1 < source.length() && source[index + 1] == '=' ) {
-                    token += source[++index] ; // >>=
-                } // if
-            } // else if
-            else {
-                ;
-            } // else
+    for ( int round = 0 ; round < 2 && p < end ; round++ ) { // "u" and "l", "ll", "L" or "LL" in any order
+        if ( ( *p | 0x20 ) == 'u' && !( flags & NUMBER_UNSIGNED ) ) {
+            flags |= NUMBER_UNSIGNED ;
+            p++ ;
         } // if
+        else if ( ( *p | 0x20 ) == 'l' && !( flags & ( NUMBER_LONG | NUMBER_LONG_LONG ) ) ) {
+            bool twice = ( p + 1 < end && p[1] == p[0] ) ; // "lL" is not a suffix
+            flags |= ( twice ? NUMBER_LONG_LONG : NUMBER_LONG ) ;
+            p += ( twice ? 2 : 1 ) ;
+        } // else if
+        else {
+            return -1 ;
+        } // else
+    } // for
 
-    } // else if
-    else if ( firstChar == '!' ) {
+    return ( p == end ? flags : -1 ) ;
 
-        if ( index + 1 < source.length() && source[index + 1] == '=' ) {
-            token += source[++index] ; // !=
-        } // if
+} // CNumberSuffix()
 
-    } // else if
-    else if ( firstChar == '=' ) {
+// Converts a literal cut with NUMBERS_C, see ParseNumber(). Octal, hex and binary INTEGERs and
+// those with a "u" may use all 64 bits, as C gives them an unsigned type when they need it.
+inline int ParseCNumber( const char * begin, const char * end, TokenType type, int64_t & iValue, double & dValue ) {
 
-        if ( index + 1 < source.length() && source[index + 1] == '=' ) {
-            token += source[++index] ; // ==
-        } // if
+    const char * p = begin ;
+    int base = 10, flags = 0 ;
 
+    if ( end - p > 2 && p[0] == '0' && ( p[1] | 0x20 ) == 'x' ) {
+        base = 16 ;
+        p += 2 ;
+    } // if
+    else if ( end - p > 2 && p[0] == '0' && ( p[1] | 0x20 ) == 'b' ) {
+        base = 2 ;
+        p += 2 ;
     } // else if
-    else if ( firstChar == '&' ) {
+    else {
+        ;
+    } // else
 
-        if ( index + 1 < source.length() && ( source[index + 1] == '&' || source[index + 1] == '=' ) ) {
-            token += source[++index] ; // && &=
-        } // if
+    const char * suffix = p ; // the digits, '.', separators and exponent end where the suffix begins
+    bool exponent = false ;
 
-    } // else if
-    else if ( firstChar == '|' ) {
+    while ( suffix < end ) {
+
+        char ch = *suffix ;
+        int digitBase = ( exponent ? 10 : base ) ;
 
-        if ( index + 1 < source.length() && ( source[index + 1] == '|' || source[index + 1] == '=' ) ) {
-            token += source[++index] ; // || |=
+        if ( DigitValue( ch ) < digitBase || ch == '\'' || ( ch == '.' && type == DOUBLE ) ) {
+            suffix++ ;
         } // if
+        else if ( type == DOUBLE && !exponent && base != 2 && ( ch | 0x20 ) == ( base == 16 ? 'p' : 'e' ) ) {
+            exponent = true ;
+            suffix += ( suffix + 1 < end && ( suffix[1] == '+' || suffix[1] == '-' ) ? 2 : 1 ) ;
+        } // else if
+        else {
+            break ;
+        } // else
 
-    } // else if
-    else if ( firstChar == ':' ) {
+    } // while
 
-        if ( index + 1 < source.length() && source[index + 1] == ':' ) {
-            token += source[++index] ; // ::
-        } // if
+    int suffixFlags = CNumberSuffix( suffix, end, type ) ;
+    flags |= ( suffixFlags < 0 ? NUMBER_MALFORMED : suffixFlags ) ;
 
-    } // else if
-    else if ( firstChar == '#' ) {
+    if ( type == INTEGER ) {
+
+        uint64_t value = 0 ;
+        bool overflow = false ;
 
-        if ( index + 1 < source.length() && source[index + 1] == '#' ) {
-            token += source[++index] ; // ##
+        if ( base == 10 && *p == '0' && suffix - p > 1 ) {
+            base = 8 ;
         } // if
 
-    } // else if
-    else if ( firstChar == '.' ) {
+        for ( ; p < suffix ; p++ ) {
+
+            unsigned digit = ( unsigned ) DigitValue( *p ) ;
 
-        if ( index + 1 < source.length() ) {
-            if ( source[index + 1] == '*' ) {
-                token += source[++index] ; // .*
+            if ( *p == '\'' ) {
+                continue ;
             } // if
-            else if ( IsDigit( source[index + 1] ) ) {
-                return GetNumberToken( firstChar, index, source, false ) ; // number
+            else if ( digit >= ( unsigned ) base ) { // 8 or 9 in an octal literal
+                flags |= NUMBER_MALFORMED ;
+            } // else if
+            else if ( value > ( UINT64_MAX - digit ) / ( unsigned ) base ) {
+                overflow = true ;
             } // else if
             else {
-                ;
-            } // else            
+                value = value * ( unsigned ) base + digit ;
+            } // else
+
+        } // for
+
+        bool wide = ( base != 10 || ( flags & NUMBER_UNSIGNED ) ) ;
+
+        if ( overflow || ( !wide && value > ( uint64_t ) INT64_MAX ) ) {
+            iValue = ( wide ? -1 : INT64_MAX ) ; // -1 has all 64 bits set
+            return flags | NUMBER_OVERFLOW ;
         } // if
 
-    } // else if
-    else if ( firstChar == '^' ) {
+        iValue = ( int64_t ) value ;
+        return flags ;
+
+    } // if
+
+    char buffer[128] ; // from_chars() wants the digits without the prefix and the separators
+    std::string longText ;
+    char * text = buffer ;
+    size_t textLength = 0 ;
+
+    if ( ( size_t ) ( suffix - p ) > sizeof( buffer ) ) {
+        longText.resize( suffix - p ) ;
+        text = &longText[0] ;
+    } // if
 
-        if ( index + 1 < source.length() && source[index + 1] == '=' ) {
-            token += source[++index] ; // ^=
+    for ( ; p < suffix ; p++ ) {
+        if ( *p != '\'' ) {
+            text[textLength++] = *p ;
         } // if
+    } // for
 
+    std::from_chars_result result = std::from_chars( text, text + textLength, dValue,
+                                                     base == 16 ? std::chars_format::hex : std::chars_format::general ) ;
+
+    if ( result.ec == std::errc::result_out_of_range ) {
+        bool large = NumberIsLarge( text, text + textLength, base ) ;
+        dValue = ( large ? HUGE_VAL : 0.0 ) ;
+        flags |= ( large ? NUMBER_OVERFLOW : NUMBER_UNDERFLOW ) ;
+    } // if
+    else if ( result.ec != std::errc() ) {
+        dValue = 0.0 ;
+        flags |= NUMBER_MALFORMED ;
     } // else if
     else {
         ;
     } // else
 
-    return TokenData( token, 0, 0.0, "", DELIMITER ) ; ;
+    if ( result.ptr != text + textLength || ( base == 16 && !exponent ) || base == 2 ) {
+        flags |= NUMBER_MALFORMED ;
+    } // if
 
-} // TokenProcessor::GetDelimiterToken()
+    return flags ;
 
-bool TokenProcessor::GetToken( TokenData & token ) {
+} // ParseCNumber()
 
-    if ( mRowIndex < mTokenBox.size() ) {
+// A bump allocator: memory comes from large blocks and is only given back all at once.
+// Reset() is O(1) and keeps the blocks, so the next source reuses them.
+class TokenArena {
 
-        token = mTokenBox[mRowIndex][mColumnIndex] ;
-        mColumnIndex++ ;
+private:
 
-        if ( mColumnIndex >= mTokenBox[mRowIndex].size() ) {
-            mRowIndex++ ;
-            mColumnIndex = 0 ;
-        } // if
+    struct Block {
+        char * data ;
+        size_t size ;
+    } ; // struct Block
 
-        return true ;
+    std::vector<Block> mBlocks ; // blocks before mCurrent are full, blocks after it are spare
+    size_t mCurrent ;
+    size_t mUsed ; // bytes used in mBlocks[mCurrent]
+    size_t mBlockSize ;
 
-    } // if
-    else {
-        token = TokenData() ;
-        return false ;
-    } // else
+public:
 
-} // TokenProcessor::GetToken()
+    TokenArena( size_t blockSize = 1 << 16 ) : mCurrent( 0 ), mUsed( 0 ), mBlockSize( blockSize ) {} // constructor
+    ~TokenArena() ; // destructor
 
-bool TokenProcessor::GetToken( TokenData & token, int times ) {
+    TokenArena( const TokenArena & ) = delete ;
+    TokenArena & operator=( const TokenArena & ) = delete ;
 
-    if ( times <= 0 ) {
-        return false ;
-    } // if
+    char * Allocate( size_t size ) ;
+    void Reset() ;
+    void Adopt( TokenArena & other ) ;
 
-    bool successOrNot = true ;
+    size_t GetBlockCount() const { return mBlocks.size() ; }
+
+} ; // class TokenArena
+
+inline TokenArena::~TokenArena() { // destructor
+
+    for ( size_t i = 0 ; i < mBlocks.size() ; i++ ) {
+        delete [] mBlocks[i].data ;
+    } // for
+
+} // TokenArena::~TokenArena()
+
+inline char * TokenArena::Allocate( size_t size ) {
+
+    while ( mCurrent < mBlocks.size() ) {
+
+        if ( mUsed + size <= mBlocks[mCurrent].size ) {
+            char * memory = mBlocks[mCurrent].data + mUsed ;
+            mUsed += size ;
+            return memory ;
+        } // if
+
+        mCurrent++ ;
+        mUsed = 0 ;
 
-    while ( ( times-- ) && successOrNot ) {
-        successOrNot = GetToken( token ) ;
     } // while
 
-    return successOrNot ;
+    Block block ;
+    block.size = ( size > mBlockSize ? size : mBlockSize ) ;
+    block.data = new char[block.size] ;
 
-} // TokenProcessor::GetToken()
+    mBlocks.push_back( block ) ;
+    mCurrent = mBlocks.size() - 1 ;
+    mUsed = size ;
 
-bool TokenProcessor::PeekToken( TokenData & token ) {
+    return block.data ;
 
-    if ( mRowIndex < mTokenBox.size() ) {
-        token = mTokenBox[mRowIndex][mColumnIndex] ;
-        return true ;
-    } // if
-    else {
-        token = TokenData() ;
-        return false ;
-    } // else
+} // TokenArena::Allocate()
 
-} // TokenProcessor::PeekToken()
+inline void TokenArena::Reset() {
+    mCurrent = 0 ;
+    mUsed = 0 ;
+} // TokenArena::Reset()
 
-void TokenProcessor::Output( bool setBracket = true, bool setBoundary = true ) {
+// Takes every block of "other", so memory allocated there stays valid until this arena resets.
+inline void TokenArena::Adopt( TokenArena & other ) {
 
-    if ( setBoundary ) {
-        std::cout << "---------- Tokens ----------" << std::endl ;
-    } // if
+    size_t used = ( other.mCurrent < other.mBlocks.size() ? other.mCurrent + 1 : other.mBlocks.size() ) ;
 
-    for ( size_t i = 0 ; i < mTokenBox.size() ; i++ ) {
+    mBlocks.insert( mBlocks.begin() + mCurrent, other.mBlocks.begin(), other.mBlocks.begin() + used ) ;
+    mCurrent += used ;
+    mBlocks.insert( mBlocks.end(), other.mBlocks.begin() + used, other.mBlocks.end() ) ;
 
-        for ( size_t j = 0 ; j < mTokenBox[i].size() ; j++ ) {
+    other.mBlocks.clear() ;
+    other.mCurrent = other.mUsed = 0 ;
 
-            if ( setBracket ) {
-                std::cout << "[" << mTokenBox[i][j].token << "]" << "  " ;
-            } // if
-            else {
-                std::cout << mTokenBox[i][j].token << "  " ;
-            } // else
+} // TokenArena::Adopt()
 
-        } // for
+# define SCAN_SCALAR 0
+# define SCAN_SSE2 1
+# define SCAN_AVX2 2
 
-        std::cout << std::endl ;
+// Kernels that find the end of a run of default-class characters.
+// Each returns the first index in [index, length) that ends the run, or length.
+struct ScanKernels {
+    size_t ( * skipWhite )( const char * source, size_t index, size_t length ) ;
+    size_t ( * identifierEnd )( const char * source, size_t index, size_t length ) ;
+    size_t ( * digitEnd )( const char * source, size_t index, size_t length ) ;
+    size_t ( * stringStop )( const char * source, size_t index, size_t length, char boundaryChar ) ; // boundary or '\\'
+    int level ;
+} ; // struct ScanKernels
 
-    } // for
+inline size_t ScalarRunEnd( const char * source, size_t index, size_t length, CharClass flag ) {
 
-    if ( setBoundary ) {
-        std::cout << "----------------------------" << std::endl ;
-    } // if
+    while ( index < length && ( kDefaultCharClasses.flags[( unsigned char ) source[index]] & flag ) ) {
+        index++ ;
+    } // while
 
-} // TokenProcessor::Output()
+    return index ;
 
-void TokenProcessor::OutputOriginal( bool setBoundary = true ) {
+} // ScalarRunEnd()
 
-    if ( setBoundary ) {
-        std::cout << "---------- Original ----------" << std::endl ;
-    } // if
+inline size_t ScalarSkipWhite( const char * source, size_t index, size_t length ) {
+    return ScalarRunEnd( source, index, length, CLASS_WHITE ) ;
+} // ScalarSkipWhite()
+
+inline size_t ScalarIdentifierEnd( const char * source, size_t index, size_t length ) {
+    return ScalarRunEnd( source, index, length, CLASS_IDENTIFIER ) ;
+} // ScalarIdentifierEnd()
+
+inline size_t ScalarDigitEnd( const char * source, size_t index, size_t length ) {
+    return ScalarRunEnd( source, index, length, CLASS_DIGIT ) ;
+} // ScalarDigitEnd()
+
+inline size_t ScalarStringStop( const char * source, size_t index, size_t length, char boundaryChar ) {
 
-    for ( size_t i = 0 ; i < mOriginalContent.size() ; i++ ) {
-        std::cout << mOriginalContent[i] << std::endl ;
+    while ( index < length && source[index] != boundaryChar && source[index] != '\\' ) {
+        index++ ;
+    } // while
+
+    return index ;
+
+} // ScalarStringStop()
+
+# if defined( __x86_64__ ) || defined( _M_X64 ) || defined( __SSE2__ )
+# define TOKEN_PROCESSOR_HAS_SSE2 1
+# include <immintrin.h>
+# if defined( _MSC_VER ) && !defined( __clang__ )
+# include <intrin.h>
+# define TOKEN_PROCESSOR_AVX2_TARGET
+# else
+# define TOKEN_PROCESSOR_AVX2_TARGET __attribute__(( target( "avx2" ) ))
+# endif
+# else
+# define TOKEN_PROCESSOR_HAS_SSE2 0
+# endif
+
+# if TOKEN_PROCESSOR_HAS_SSE2
+
+inline unsigned CountTrailingZeros( unsigned mask ) {
+
+# if defined( _MSC_VER ) && !defined( __clang__ )
+    unsigned long bit = 0 ;
+    _BitScanForward( &bit, mask ) ;
+    return ( unsigned ) bit ;
+# else
+    return ( unsigned ) __builtin_ctz( mask ) ;
+# endif
+
+} // CountTrailingZeros()
+
+// Signed byte compares are enough: bytes >= 0x80 are negative and never inside an ASCII range.
+inline __m128i Sse2InRange( __m128i chunk, char low, char high ) {
+    return _mm_and_si128( _mm_cmpgt_epi8( chunk, _mm_set1_epi8( ( char ) ( low - 1 ) ) ),
+                          _mm_cmplt_epi8( chunk, _mm_set1_epi8( ( char ) ( high + 1 ) ) ) ) ;
+} // Sse2InRange()
+
+inline __m128i Sse2WhiteMask( __m128i chunk ) {
+    return _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( chunk, _mm_set1_epi8( ' ' ) ), _mm_cmpeq_epi8( chunk, _mm_set1_epi8( '\t' ) ) ),
+                         _mm_or_si128( _mm_cmpeq_epi8( chunk, _mm_set1_epi8( '\n' ) ), _mm_cmpeq_epi8( chunk, _mm_set1_epi8( '\r' ) ) ) ) ;
+} // Sse2WhiteMask()
+
+inline __m128i Sse2IdentifierMask( __m128i chunk ) {
+    __m128i lower = _mm_or_si128( chunk, _mm_set1_epi8( 0x20 ) ) ; // 'A' - 'Z' become 'a' - 'z'
+    return _mm_or_si128( _mm_or_si128( Sse2InRange( lower, 'a', 'z' ), Sse2InRange( chunk, '0', '9' ) ),
+                         _mm_cmpeq_epi8( chunk, _mm_set1_epi8( '_' ) ) ) ;
+} // Sse2IdentifierMask()
+
+inline size_t Sse2SkipWhite( const char * source, size_t index, size_t length ) {
+
+    for ( ; index + 16 <= length ; index += 16 ) {
+        __m128i chunk = _mm_loadu_si128( ( const __m128i * ) ( source + index ) ) ;
+        unsigned mask = ~( unsigned ) _mm_movemask_epi8( Sse2WhiteMask( chunk ) ) & 0xFFFF ;
+        if ( mask != 0 ) {
+            return index + CountTrailingZeros( mask ) ;
+        } // if
     } // for
 
-    if ( setBoundary ) {
-        std::cout << "------------------------------" << std::endl ;
-    } // if
+    return ScalarSkipWhite( source, index, length ) ;
 
-} // TokenProcessor::OutputOriginal() 
+} // Sse2SkipWhite()
 
-void TokenProcessor::Clear() {
+inline size_t Sse2IdentifierEnd( const char * source, size_t index, size_t length ) {
 
-    mOriginalContent.clear() ;
-    mTokenBox.clear() ;
-    mRowIndex = mColumnIndex = 0 ;
+    for ( ; index + 16 <= length ; index += 16 ) {
+        __m128i chunk = _mm_loadu_si128( ( const __m128i * ) ( source + index ) ) ;
+        unsigned mask = ~( unsigned ) _mm_movemask_epi8( Sse2IdentifierMask( chunk ) ) & 0xFFFF ;
+        if ( mask != 0 ) {
+            return index + CountTrailingZeros( mask ) ;
+        } // if
+    } // for
 
-} // TokenProcessor::Clear()
+    return ScalarIdentifierEnd( source, index, length ) ;
 
-void TokenProcessor::BackToBeginning() {
-    mRowIndex = mColumnIndex = 0 ;
-} //  TokenProcessor::BackToBeginning()
+} // Sse2IdentifierEnd()
 
-char TokenProcessor::ChangeChar( char ch ) {
+inline size_t Sse2DigitEnd( const char * source, size_t index, size_t length ) {
 
-    if ( ch == 'n' ) {
-        return '\n' ;
-    } // if
-    else if ( ch == 'r' ) {
-        return '\r' ;
-    } // else if
-    else if ( ch == 't' ) {
-        return '\t' ;
-    } // else if
-    else if ( ch == 'a' ) {
-        return '\a' ;
-    } // else if
-    else if ( ch == 'b' ) {
-        return '\b' ;
-    } // else if
-    else if ( ch == 'f' ) {
-        return '\f' ;
-    } // else if
-    else if ( ch == 'v' ) {
-        return '\v' ;
-    } // else if
-    else {
-        return ch ;
-    } // else
+    for ( ; index + 16 <= length ; index += 16 ) {
+        __m128i chunk = _mm_loadu_si128( ( const __m128i * ) ( source + index ) ) ;
+        unsigned mask = ~( unsigned ) _mm_movemask_epi8( Sse2InRange( chunk, '0', '9' ) ) & 0xFFFF ;
+        if ( mask != 0 ) {
+            return index + CountTrailingZeros( mask ) ;
+        } // if
+    } // for
+
+    return ScalarDigitEnd( source, index, length ) ;
 
-} // TokenProcessor::ChangeChar()
+} // Sse2DigitEnd()
 
-bool TokenProcessor::IsWhite( char ch ) {
-    return ( ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' ) ;
-} // TokenProcessor::IsWhite()
+inline size_t Sse2StringStop( const char * source, size_t index, size_t length, char boundaryChar ) {
 
-bool TokenProcessor::IsLetter( char ch ) {
-    return ( 'a' <= ch && ch <= 'z' ) || ( 'A' <= ch && ch <= 'Z' ) ;
-} // TokenProcessor::IsLetter()
+    __m128i boundary = _mm_set1_epi8( boundaryChar ), backslash = _mm_set1_epi8( '\\' ) ;
 
-bool TokenProcessor::IsDigit( char ch ) {
-    return ( '0' <= ch && ch <= '9' ) ;
-} // TokenProcessor::IsDigit()
+    for ( ; index + 16 <= length ; index += 16 ) {
+        __m128i chunk = _mm_loadu_si128( ( const __m128i * ) ( source + index ) ) ;
+        unsigned mask = ( unsigned ) _mm_movemask_epi8( _mm_or_si128( _mm_cmpeq_epi8( chunk, boundary ),
+                                                                       _mm_cmpeq_epi8( chunk, backslash ) ) ) ;
+        if ( mask != 0 ) {
+            return index + CountTrailingZeros( mask ) ;
+        } // if
+    } // for
 
-bool TokenProcessor::IsDelimiter( char ch ) {
+    return ScalarStringStop( source, index, length, boundaryChar ) ;
 
-    for ( size_t i = 0 ; i < mDelimitersList.length() ; i++ ) {
-        if ( mDelimitersList[i] == ch ) {
-            return true ;
+} // Sse2StringStop()
+
+TOKEN_PROCESSOR_AVX2_TARGET inline __m256i Avx2InRange( __m256i chunk, char low, char high ) {
+    return _mm256_and_si256( _mm256_cmpgt_epi8( chunk, _mm256_set1_epi8( ( char ) ( low - 1 ) ) ),
+                             _mm256_cmpgt_epi8( _mm256_set1_epi8( ( char ) ( high + 1 ) ), chunk ) ) ;
+} // Avx2InRange()
+
+TOKEN_PROCESSOR_AVX2_TARGET inline size_t Avx2SkipWhite( const char * source, size_t index, size_t length ) {
+
+    for ( ; index + 32 <= length ; index += 32 ) {
+        __m256i chunk = _mm256_loadu_si256( ( const __m256i * ) ( source + index ) ) ;
+        __m256i white = _mm256_or_si256( _mm256_or_si256( _mm256_cmpeq_epi8( chunk, _mm256_set1_epi8( ' ' ) ),
+                                                          _mm256_cmpeq_epi8( chunk, _mm256_set1_epi8( '\t' ) ) ),
+                                         _mm256_or_si256( _mm256_cmpeq_epi8( chunk, _mm256_set1_epi8( '\n' ) ),
+                                                          _mm256_cmpeq_epi8( chunk, _mm256_set1_epi8( '\r' ) ) ) ) ;
+        unsigned mask = ~( unsigned ) _mm256_movemask_epi8( white ) ;
+        if ( mask != 0 ) {
+            return index + CountTrailingZeros( mask ) ;
         } // if
     } // for
 
-    return false ;
+    return Sse2SkipWhite( source, index, length ) ;
 
-} // TokenProcessor::IsDelimiter()
+} // Avx2SkipWhite()
 
-# endif // TOKEN_PROCESSOR_H_INCLUDED
+TOKEN_PROCESSOR_AVX2_TARGET inline size_t Avx2IdentifierEnd( const char * source, size_t index, size_t length ) {
 
+    for ( ; index + 32 <= length ; index += 32 ) {
+        __m256i chunk = _mm256_loadu_si256( ( const __m256i * ) ( source + index ) ) ;
+        __m256i lower = _mm256_or_si256( chunk, _mm256_set1_epi8( 0x20 ) ) ;
+        __m256i identifier = _mm256_or_si256( _mm256_or_si256( Avx2InRange( lower, 'a', 'z' ), Avx2InRange( chunk, '0', '9' ) ),
+                                              _mm256_cmpeq_epi8( chunk, _mm256_set1_epi8( '_' ) ) ) ;
+        unsigned mask = ~( unsigned ) _mm256_movemask_epi8( identifier ) ;
+        if ( mask != 0 ) {
+            return index + CountTrailingZeros( mask ) ;
+        } // if
+    } // for
+
+    return Sse2IdentifierEnd( source, index, length ) ;
+
+} // Avx2IdentifierEnd()
+
+TOKEN_PROCESSOR_AVX2_TARGET inline size_t Avx2DigitEnd( const char * source, size_t index, size_t length ) {
+
+    for ( ; index + 32 <= length ; index += 32 ) {
+        __m256i chunk = _mm256_loadu_si256( ( const __m256i * ) ( source + index ) ) ;
+        unsigned mask = ~( unsigned ) _mm256_movemask_epi8( Avx2InRange( chunk, '0', '9' ) ) ;
+        if ( mask != 0 ) {
+            return index + CountTrailingZeros( mask ) ;
+        } // if
+    } // for
+
+    return Sse2DigitEnd( source, index, length ) ;
+
+} // Avx2DigitEnd()
+
+TOKEN_PROCESSOR_AVX2_TARGET inline size_t Avx2StringStop( const char * source, size_t index, size_t length, char boundaryChar ) {
+
+    __m256i boundary = _mm256_set1_epi8( boundaryChar ), backslash = _mm256_set1_epi8( '\\' ) ;
+
+    for ( ; index + 32 <= length ; index += 32 ) {
+        __m256i chunk = _mm256_loadu_si256( ( const __m256i * ) ( source + index ) ) ;
+        unsigned mask = ( unsigned ) _mm256_movemask_epi8( _mm256_or_si256( _mm256_cmpeq_epi8( chunk, boundary ),
+                                                                             _mm256_cmpeq_epi8( chunk, backslash ) ) ) ;
+        if ( mask != 0 ) {
+            return index + CountTrailingZeros( mask ) ;
+        } // if
+    } // for
+
+    return Sse2StringStop( source, index, length, boundaryChar ) ;
+
+} // Avx2StringStop()
+
+inline bool CpuHasAvx2() {
+
+# if defined( _MSC_VER ) && !defined( __clang__ )
+    int info[4] = { 0 } ;
+
+    __cpuid( info, 0 ) ;
+    if ( info[0] < 7 ) {
+        return false ;
+    } // if
+
+    __cpuid( info, 1 ) ;
+    if ( ( info[2] & ( 1 << 27 ) ) == 0 || ( _xgetbv( 0 ) & 6 ) != 6 ) { // the OS saves the ymm registers
+        return false ;
+    } // if
+
+    __cpuidex( info, 7, 0 ) ;
+    return ( info[1] & ( 1 << 5 ) ) != 0 ;
+# else
+    __builtin_cpu_init() ;
+    return __builtin_cpu_supports( "avx2" ) != 0 ;
+# endif
+
+} // CpuHasAvx2()
+
+# endif // TOKEN_PROCESSOR_HAS_SSE2
+
+// The best kernels this CPU runs, no better than "level".
+inline const ScanKernels * SelectScanKernels( int level ) {
+
+    static const ScanKernels scalar = { ScalarSkipWhite, ScalarIdentifierEnd, ScalarDigitEnd, ScalarStringStop, SCAN_SCALAR } ;
+
+# if TOKEN_PROCESSOR_HAS_SSE2
+    static const ScanKernels sse2 = { Sse2SkipWhite, Sse2IdentifierEnd, Sse2DigitEnd, Sse2StringStop, SCAN_SSE2 } ;
+    static const ScanKernels avx2 = { Avx2SkipWhite, Avx2IdentifierEnd, Avx2DigitEnd, Avx2StringStop, SCAN_AVX2 } ;
+    static const bool hasAvx2 = CpuHasAvx2() ;
+
+    if ( level >= SCAN_AVX2 && hasAvx2 ) {
+        return &avx2 ;
+    } // if
+    else if ( level >= SCAN_SSE2 ) {
+        return &sse2 ;
+    } // else if
+    else {
+        return &scalar ;
+    } // else
+# else
+    ( void ) level ;
+    return &scalar ;
+# endif
+
+} // SelectScanKernels()
+
+// A read-only mapping of a whole file.
+class MappedFile {
+
+private:
+
+    const char * mData ;
+    size_t mLength ;
+
+public:
+
+    MappedFile() : mData( NULL ), mLength( 0 ) {} // constructor
+    ~MappedFile() { Unmap() ; } // destructor
+
+    MappedFile( const MappedFile & ) = delete ;
+    MappedFile & operator=( const MappedFile & ) = delete ;
+
+    bool Map( int fd, size_t length ) ;
+    void Unmap() ;
+
+    const char * Data() const { return mData ; }
+    size_t Length() const { return mLength ; }
+
+} ; // class MappedFile
+
+inline bool MappedFile::Map( int fd, size_t length ) {
+
+    Unmap() ;
+
+# if TOKEN_PROCESSOR_HAS_MMAP
+    void * data = mmap( NULL, length, PROT_READ, MAP_PRIVATE, fd, 0 ) ;
+
+    if ( data == MAP_FAILED ) {
+        return false ;
+    } // if
+
+    madvise( data, length, MADV_SEQUENTIAL ) ;
+
+    mData = ( const char * ) data ;
+    mLength = length ;
+    return true ;
+# else
+    ( void ) fd ;
+    ( void ) length ;
+    return false ;
+# endif
+
+} // MappedFile::Map()
+
+inline void MappedFile::Unmap() {
+
+# if TOKEN_PROCESSOR_HAS_MMAP
+    if ( mData != NULL ) {
+        munmap( ( void * ) mData, mLength ) ;
+    } // if
+# endif
+
+    mData = NULL ;
+    mLength = 0 ;
+
+} // MappedFile::Unmap()
+
+// The 8 bytes at "data" as a little-endian number on any machine.
+inline uint64_t LittleEndianWord( const char * data ) {
+
+    uint64_t word = 0 ;
+
+    memcpy( &word, data, 8 ) ;
+# if defined( __BYTE_ORDER__ ) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64( word ) ;
+# endif
+    return word ;
+
+} // LittleEndianWord()
+
+// A fast 64-bit hash, four independent lanes of 8 bytes a step; the same on every machine,
+// since a token cache keeps it. Only for telling a changed input, not for security.
+inline uint64_t HashBytes( const char * data, size_t length, uint64_t hash ) {
+
+    const uint64_t multiplier = 0xFF51AFD7ED558CCDull ;
+    uint64_t lanes[4] = { hash, hash + 1, hash + 2, hash + 3 } ;
+    size_t i = 0 ;
+
+    for ( ; i + 32 <= length ; i += 32 ) {
+        for ( int j = 0 ; j < 4 ; j++ ) {
+            lanes[j] = ( lanes[j] ^ LittleEndianWord( data + i + 8 * j ) ) * multiplier ;
+            lanes[j] ^= lanes[j] >> 32 ;
+        } // for
+    } // for
+
+    hash = length * 0x9E3779B97F4A7C15ull ;
+
+    for ( int j = 0 ; j < 4 ; j++ ) {
+        hash = ( hash ^ lanes[j] ) * multiplier ;
+        hash ^= hash >> 32 ;
+    } // for
+
+    for ( ; i + 8 <= length ; i += 8 ) {
+        hash = ( hash ^ LittleEndianWord( data + i ) ) * multiplier ;
+        hash ^= hash >> 32 ;
+    } // for
+
+    uint64_t last = 0 ;
+
+    for ( size_t j = 0 ; i + j < length ; j++ ) {
+        last |= ( uint64_t ) ( unsigned char ) data[i + j] << ( 8 * j ) ;
+    } // for
+
+    hash = ( hash ^ last ) * multiplier ;
+    return hash ^ ( hash >> 29 ) ;
+
+} // HashBytes()
+
+// Unsigned LEB128, 7 bits a byte; returns the bytes used in "buffer" (10 at most).
+inline size_t PutVarint( char * buffer, uint64_t value ) {
+
+    size_t length = 0 ;
+
+    while ( value >= 0x80 ) {
+        buffer[length++] = ( char ) ( ( value & 0x7F ) | 0x80 ) ;
+        value >>= 7 ;
+    } // while
+
+    buffer[length++] = ( char ) value ;
+    return length ;
+
+} // PutVarint()
+
+// Returns false instead of reading past "end".
+inline bool GetVarint( const unsigned char * & data, const unsigned char * end, uint64_t & value ) {
+
+    if ( data < end && *data < 0x80 ) { // most values are small
+        value = *data++ ;
+        return true ;
+    } // if
+
+    value = 0 ;
+
+    for ( int shift = 0 ; data < end && shift < 64 ; shift += 7 ) {
+
+        unsigned char byte = *data++ ;
+        value |= ( uint64_t ) ( byte & 0x7F ) << shift ;
+
+        if ( ( byte & 0x80 ) == 0 ) {
+            return true ;
+        } // if
+
+    } // for
+
+    return false ;
+
+} // GetVarint()
+
+// Names of identifiers, each kept once and numbered from 0 in the order they were first seen.
+// Keywords are added before anything else, so a name is a keyword exactly when its id is below
+// GetKeywordCount(). Ids never change until Clear(). Not safe to change from several threads at once.
+class SymbolTable {
+
+private:
+
+    std::vector<std::string_view> mNames ; // by id, the bytes are in mArena
+    std::vector<uint64_t> mHashes ; // by id, so that growing never hashes a name again
+    std::vector<uint32_t> mSlots ; // open addressing with linear probing, id + 1 or 0 when empty
+    TokenArena mArena ;
+    uint32_t mKeywordCount ;
+
+    size_t FindSlot( const char * name, size_t length, uint64_t hash ) const ;
+    void Grow() ;
+
+public:
+
+    SymbolTable() : mSlots( 256, 0 ), mKeywordCount( 0 ) {} // constructor
+
+    SymbolTable( const SymbolTable & ) = delete ;
+    SymbolTable & operator=( const SymbolTable & ) = delete ;
+
+    uint32_t Intern( const char * name, size_t length ) ;
+    uint32_t Find( std::string_view name ) const ;
+    bool AddKeyword( std::string_view name ) ;
+
+    bool IsKeyword( uint32_t id ) const { return id < mKeywordCount ; }
+    uint32_t GetKeywordCount() const { return mKeywordCount ; }
+    std::string_view GetName( uint32_t id ) const { return id < mNames.size() ? mNames[id] : std::string_view() ; }
+    size_t Size() const { return mNames.size() ; }
+
+    void Clear() ;
+
+} ; // class SymbolTable
+
+// The slot that holds the name, or the empty slot where it would go.
+inline size_t SymbolTable::FindSlot( const char * name, size_t length, uint64_t hash ) const {
+
+    size_t mask = mSlots.size() - 1 ;
+
+    for ( size_t i = ( size_t ) hash & mask ; ; i = ( i + 1 ) & mask ) {
+
+        uint32_t slot = mSlots[i] ;
+
+        if ( slot == 0 ) {
+            return i ;
+        } // if
+        else if ( mHashes[slot - 1] == hash && mNames[slot - 1].length() == length &&
+                  memcmp( mNames[slot - 1].data(), name, length ) == 0 ) {
+            return i ;
+        } // else if
+        else {
+            ;
+        } // else
+
+    } // for
+
+} // SymbolTable::FindSlot()
+
+inline void SymbolTable::Grow() {
+
+    std::vector<uint32_t> slots( mSlots.size() * 2, 0 ) ;
+    size_t mask = slots.size() - 1 ;
+
+    for ( size_t id = 0 ; id < mNames.size() ; id++ ) {
+
+        size_t i = ( size_t ) mHashes[id] & mask ;
+
+        while ( slots[i] != 0 ) {
+            i = ( i + 1 ) & mask ;
+        } // while
+
+        slots[i] = ( uint32_t ) id + 1 ;
+
+    } // for
+
+    mSlots.swap( slots ) ;
+
+} // SymbolTable::Grow()
+
+// The id of the name, added with the next id if it is new.
+inline uint32_t SymbolTable::Intern( const char * name, size_t length ) {
+
+    uint64_t hash = HashBytes( name, length, 0 ) ;
+    size_t i = FindSlot( name, length, hash ) ;
+
+    if ( mSlots[i] != 0 ) {
+        return mSlots[i] - 1 ;
+    } // if
+
+    if ( ( mNames.size() + 1 ) * 4 > mSlots.size() * 3 ) { // at most 3/4 full
+        Grow() ;
+        i = FindSlot( name, length, hash ) ;
+    } // if
+
+    char * copy = mArena.Allocate( length > 0 ? length : 1 ) ;
+    memcpy( copy, name, length ) ;
+
+    mNames.push_back( std::string_view( copy, length ) ) ;
+    mHashes.push_back( hash ) ;
+    mSlots[i] = ( uint32_t ) mNames.size() ;
+
+    return ( uint32_t ) mNames.size() - 1 ;
+
+} // SymbolTable::Intern()
+
+// The id of the name, or NO_SYMBOL if it was never interned.
+inline uint32_t SymbolTable::Find( std::string_view name ) const {
+    size_t i = FindSlot( name.data(), name.length(), HashBytes( name.data(), name.length(), 0 ) ) ;
+    return mSlots[i] - 1 ; // an empty slot gives NO_SYMBOL
+} // SymbolTable::Find()
+
+// Returns false once a name that is not a keyword has an id, since keywords must come first.
+inline bool SymbolTable::AddKeyword( std::string_view name ) {
+
+    uint32_t id = Find( name ) ;
+
+    if ( id != NO_SYMBOL ) {
+        return IsKeyword( id ) ;
+    } // if
+    else if ( mNames.size() != mKeywordCount ) {
+        return false ;
+    } // else if
+    else {
+        Intern( name.data(), name.length() ) ;
+        mKeywordCount++ ;
+        return true ;
+    } // else
+
+} // SymbolTable::AddKeyword()
+
+// Forgets every name and keyword.
+inline void SymbolTable::Clear() {
+    mNames.clear() ;
+    mHashes.clear() ;
+    mSlots.assign( 256, 0 ) ;
+    mArena.Reset() ;
+    mKeywordCount = 0 ;
+} // SymbolTable::Clear()
+
+// Where a line starts in the source buffer, and its first token in the token box.
+// The tokens of a line run up to the first token of the next line.
+// "pending" is what was still open when the line began, PENDING_NONE without comment mode.
+struct LineRecord {
+    size_t offset ;
+    size_t firstToken ;
+    int pending ;
+    LineRecord( size_t off, size_t first, int p = PENDING_NONE ) : offset( off ), firstToken( first ), pending( p ) {} // constructor
+} ; // struct LineRecord
+
+// Lines cut apart from the processor, so that parts of a source can be cut in parallel.
+struct TokenChunk {
+    std::vector<LineRecord> lines ;
+    std::vector<TokenRecord> tokenBox ;
+    TokenArena arena ;
+} ; // struct TokenChunk
+
+// How far the records from "index" on have moved since they were written.
+// "count" is added to firstToken of a line, or to line of a token.
+struct RecordShift {
+    size_t index ;
+    size_t bytes ;
+    size_t count ;
+} ; // struct RecordShift
+
+// The moves ReplaceLines() leaves to be added when a record is read, so that the records
+// after the lines replaced are not rewritten. Each move holds up to the index of the next one.
+class RecordShifts {
+
+private:
+
+    std::vector<RecordShift> mShifts ; // by index
+    size_t mEnd ; // the records from here on have not moved
+
+    static void Add( std::vector<RecordShift> & shifts, size_t index, size_t bytes, size_t count ) ;
+
+public:
+
+    RecordShifts() : mEnd( 0 ) {} // constructor
+
+    size_t size() const { return mShifts.size() ; }
+    bool empty() const { return mShifts.empty() ; }
+    const RecordShift & operator[]( size_t k ) const { return mShifts[k] ; }
+    size_t End( size_t k ) const { return ( k + 1 < mShifts.size() ? mShifts[k + 1].index : mEnd ) ; }
+
+    RecordShift At( size_t index ) const ;
+    void Replace( size_t first, size_t oldEnd, size_t newEnd, size_t size, size_t bytes, size_t count ) ;
+    void Truncate( size_t end ) ;
+    void clear() ;
+
+} ; // class RecordShifts
+
+// Adds a move from "index" on, in place of the ones it covers; none if it moves nothing more.
+inline void RecordShifts::Add( std::vector<RecordShift> & shifts, size_t index, size_t bytes, size_t count ) {
+
+    while ( !shifts.empty() && shifts.back().index >= index ) {
+        shifts.pop_back() ;
+    } // while
+
+    size_t lastBytes = ( shifts.empty() ? 0 : shifts.back().bytes ) ;
+    size_t lastCount = ( shifts.empty() ? 0 : shifts.back().count ) ;
+
+    if ( bytes != lastBytes || count != lastCount ) {
+        RecordShift shift = { index, bytes, count } ;
+        shifts.push_back( shift ) ;
+    } // if
+
+} // RecordShifts::Add()
+
+// The move of record "index", by a binary search.
+inline RecordShift RecordShifts::At( size_t index ) const {
+
+    RecordShift none = { index, 0, 0 } ;
+
+    if ( mShifts.empty() || index >= mEnd || index < mShifts[0].index ) {
+        return none ;
+    } // if
+
+    size_t low = 0, high = mShifts.size() ; // the last move starting at or before index
+
+    while ( high - low > 1 ) {
+
+        size_t middle = ( low + high ) / 2 ;
+
+        if ( mShifts[middle].index <= index ) {
+            low = middle ;
+        } // if
+        else {
+            high = middle ;
+        } // else
+
+    } // while
+
+    return mShifts[low] ;
+
+} // RecordShifts::At()
+
+// Records [first, oldEnd) of "size" were replaced by [first, newEnd), which have not moved;
+// the ones after them move by another "bytes" and "count".
+inline void RecordShifts::Replace( size_t first, size_t oldEnd, size_t newEnd, size_t size,
+                                   size_t bytes, size_t count ) {
+
+    if ( !mShifts.empty() && mEnd < size ) {
+        Add( mShifts, mEnd, 0, 0 ) ; // the records added since
+    } // if
+
+    mEnd = size ;
+
+    std::vector<RecordShift> shifts ;
+    RecordShift tail = At( oldEnd ) ;
+    size_t k = 0 ;
+
+    for ( ; k < mShifts.size() && mShifts[k].index < first ; k++ ) {
+        shifts.push_back( mShifts[k] ) ;
+    } // for
+
+    Add( shifts, first, 0, 0 ) ;
+
+    if ( oldEnd < size ) {
+
+        Add( shifts, newEnd, tail.bytes + bytes, tail.count + count ) ;
+
+        for ( ; k < mShifts.size() ; k++ ) {
+            if ( mShifts[k].index > oldEnd ) {
+                Add( shifts, mShifts[k].index - oldEnd + newEnd, mShifts[k].bytes + bytes, mShifts[k].count + count ) ;
+            } // if
+        } // for
+
+    } // if
+
+    mShifts.swap( shifts ) ;
+    mEnd = ( mShifts.empty() ? 0 : size - oldEnd + newEnd ) ;
+
+} // RecordShifts::Replace()
+
+// Forgets the moves from "end" on, once the records there have been moved.
+inline void RecordShifts::Truncate( size_t end ) {
+
+    while ( !mShifts.empty() && mShifts.back().index >= end ) {
+        mShifts.pop_back() ;
+    } // while
+
+    mEnd = ( mShifts.empty() ? 0 : ( mEnd < end ? mEnd : end ) ) ;
+
+} // RecordShifts::Truncate()
+
+inline void RecordShifts::clear() {
+    mShifts.clear() ;
+    mEnd = 0 ;
+} // RecordShifts::clear()
+
+// Puts "records" in place of records [first, last) of "target", moving the ones after them once.
+template <class Records>
+void SpliceRecords( Records & target, size_t first, size_t last, Records & records ) {
+
+    size_t common = ( last - first < records.size() ? last - first : records.size() ) ;
+
+    for ( size_t i = 0 ; i < common ; i++ ) {
+        target[first + i] = records[i] ;
+    } // for
+
+    if ( records.size() > common ) {
+        target.insert( target.begin() + ( ptrdiff_t ) ( first + common ), records.begin() + ( ptrdiff_t ) common,
+                       records.end() ) ;
+    } // if
+    else if ( last - first > common ) {
+        target.erase( target.begin() + ( ptrdiff_t ) ( first + common ), target.begin() + ( ptrdiff_t ) last ) ;
+    } // else if
+    else {
+        ;
+    } // else
+
+} // SpliceRecords()
+
+// A token cache file, little-endian, numbers are varints unless a size is given:
+//   "TPKC", version byte, source length, source hash (8 bytes), lexer settings hash (8 bytes),
+//   hash of everything after it (8 bytes), then
+//   number table: count, 8 bytes each (int64 of an INTEGER, bits of a DOUBLE),
+//   string table: count, length and bytes each (decoded contents),
+//   lines: count, then offset - previous offset, firstToken - previous firstToken, pending byte,
+//   tokens: count, then a byte of the type (low 4 bits) and of the line - previous line
+//     (high 4 bits, 15 means a varint of it follows), offset - end of the previous token, length,
+//     a number index and a byte of NUMBER_ flags for INTEGER and DOUBLE, and for STRING and CHAR
+//     0 and the contents length (contents in the source) or 1 + a string index (decoded).
+// Tokens never overlap, so every number is small and most take one byte. The hash of the rest is
+// checked before any record is read, and every record against the source, its line and the tables
+// as it is, so a damaged cache is cut again.
+# define TOKEN_CACHE_VERSION 6
+
+// "path" with a suffix no other writer uses at the same time: the process and a count of this one.
+inline std::string TemporaryPath( const std::string & path ) {
+
+    static std::atomic<unsigned long> count( 0 ) ;
+
+# if TOKEN_PROCESSOR_HAS_MMAP
+    unsigned long process = ( unsigned long ) getpid() ;
+# else
+    unsigned long process = ( unsigned long ) std::chrono::steady_clock::now().time_since_epoch().count() ;
+# endif
+
+    return path + "." + std::to_string( process ) + "." + std::to_string( count++ ) + ".tmp" ;
+
+} // TemporaryPath()
+
+# define NO_CONTENTS SIZE_MAX
+
+// The token box split into one array per field, for passes that read only a field or two.
+// Token i is types[i], offsets[i], ... ; contents of a STRING or CHAR is contents[contentsIndexes[i]],
+// other tokens have NO_CONTENTS. Text( i ) is the token itself.
+// Only what always fits is narrower than size_t: types, the NUMBER_ flags a view has, and lines and
+// symbols, which are 32 bits in the token box too. No processor holds more lines than TOKEN_PROCESSOR_MAX_LINES.
+struct TokenColumns {
+    std::vector<uint8_t> types ;
+    std::vector<size_t> offsets ;
+    std::vector<size_t> lengths ;
+    std::vector<uint32_t> lines ;
+    std::vector<int64_t> iValues ;
+    std::vector<double> dValues ;
+    std::vector<uint8_t> numberFlags ;
+    std::vector<size_t> contentsIndexes ;
+    std::vector<std::string_view> contents ;
+    std::vector<uint32_t> symbols ;
+    std::string_view source ;
+    size_t Size() const { return types.size() ; }
+    std::string_view Text( size_t i ) const { return source.substr( offsets[i], lengths[i] ) ; }
+} ; // struct TokenColumns
+
+// Where Output() and OutputOriginal() write. Write() gets a whole buffer at a time.
+class TokenSink {
+
+public:
+
+    virtual ~TokenSink() {} // destructor
+
+    virtual bool Write( const char * data, size_t length ) = 0 ;
+    virtual bool Flush() { return true ; }
+
+} ; // class TokenSink
+
+class StreamSink : public TokenSink {
+
+private:
+
+    std::ostream * mStream ;
+
+public:
+
+    StreamSink( std::ostream & stream ) : mStream( &stream ) {} // constructor
+
+    bool Write( const char * data, size_t length ) {
+        mStream->write( data, ( std::streamsize ) length ) ;
+        return mStream->good() ;
+    } // Write()
+
+    bool Flush() {
+        mStream->flush() ;
+        return mStream->good() ;
+    } // Flush()
+
+} ; // class StreamSink
+
+class MemorySink : public TokenSink {
+
+private:
+
+    std::string mData ;
+
+public:
+
+    bool Write( const char * data, size_t length ) {
+        mData.append( data, length ) ;
+        return true ;
+    } // Write()
+
+    const std::string & Data() const { return mData ; }
+    void Clear() { mData.clear() ; }
+
+} ; // class MemorySink
+
+# if TOKEN_PROCESSOR_HAS_MMAP
+
+// One write() per buffer, straight to the descriptor.
+class FileDescriptorSink : public TokenSink {
+
+private:
+
+    int mFd ;
+
+public:
+
+    FileDescriptorSink( int fd ) : mFd( fd ) {} // constructor
+
+    bool Write( const char * data, size_t length ) ;
+
+} ; // class FileDescriptorSink
+
+inline bool FileDescriptorSink::Write( const char * data, size_t length ) {
+
+    while ( length > 0 ) {
+
+        ssize_t count = write( mFd, data, length ) ;
+
+        if ( count > 0 ) {
+            data += count ;
+            length -= ( size_t ) count ;
+        } // if
+        else if ( count < 0 && errno == EINTR ) {
+            ; // try again
+        } // else if
+        else {
+            return false ;
+        } // else
+
+    } // while
+
+    return true ;
+
+} // FileDescriptorSink::Write()
+
+# endif // TOKEN_PROCESSOR_HAS_MMAP
+
+// Collects text in one buffer that is kept from call to call, and gives it to a sink when full.
+class OutputBuffer {
+
+private:
+
+    std::vector<char> mData ;
+    size_t mUsed ;
+    TokenSink * mSink ;
+    bool mGood ;
+
+public:
+
+    OutputBuffer( size_t size = 1 << 16 ) : mData( size ), mUsed( 0 ), mSink( NULL ), mGood( true ) {} // constructor
+
+    void Begin( TokenSink & sink ) ;
+    void Append( const char * data, size_t length ) ;
+    void Append( std::string_view text ) { Append( text.data(), text.length() ) ; }
+    void Append( char ch ) { Append( &ch, 1 ) ; }
+    bool End() ;
+
+} ; // class OutputBuffer
+
+inline void OutputBuffer::Begin( TokenSink & sink ) {
+    mSink = &sink ;
+    mUsed = 0 ;
+    mGood = true ;
+} // OutputBuffer::Begin()
+
+inline void OutputBuffer::Append( const char * data, size_t length ) {
+
+    if ( mUsed + length > mData.size() ) {
+
+        mGood = mGood && mSink->Write( mData.data(), mUsed ) ;
+        mUsed = 0 ;
+
+        if ( length > mData.size() ) { // too long to be worth copying
+            mGood = mGood && mSink->Write( data, length ) ;
+            return ;
+        } // if
+
+    } // if
+
+    memcpy( mData.data() + mUsed, data, length ) ;
+    mUsed += length ;
+
+} // OutputBuffer::Append()
+
+// Writes what is left and flushes the sink; false if any write failed.
+inline bool OutputBuffer::End() {
+
+    if ( mUsed > 0 ) {
+        mGood = mGood && mSink->Write( mData.data(), mUsed ) ;
+        mUsed = 0 ;
+    } // if
+
+    mGood = mSink->Flush() && mGood ;
+    mSink = NULL ;
+    return mGood ;
+
+} // OutputBuffer::End()
+
+template <class Policy>
+class BasicTokenProcessor ;
+
+// A position to go back to, see TokenProcessor::Mark().
+struct TokenMark {
+    size_t index ; // counts the tokens from the first one, also those a stream has dropped
+} ; // struct TokenMark
+
+// A position of its own in the token box of a processor. A cursor only reads, so any number
+// of them may walk the same tokens at once, on any threads, while nothing is being cut.
+// A cursor never pulls a stream; it walks the tokens the processor holds.
+template <class Policy>
+class BasicTokenCursor {
+
+private:
+
+    BasicTokenProcessor<Policy> * mProcessor ;
+    size_t mIndex ;
+
+public:
+
+    BasicTokenCursor( BasicTokenProcessor<Policy> & processor, size_t index = 0 ) : mProcessor( &processor ), mIndex( index ) {} // constructor
+
+    bool GetToken( TokenView & token ) ;
+    bool PeekToken( TokenView & token, size_t ahead = 0 ) ;
+    size_t GetTokens( TokenView * tokens, size_t count ) ;
+    size_t Skip( size_t count ) ;
+
+    TokenMark Mark() ;
+    bool Reset( TokenMark mark ) ;
+
+} ; // class BasicTokenCursor
+
+# ifndef TOKEN_PROCESSOR_PARALLEL_MIN_BYTES
+# define TOKEN_PROCESSOR_PARALLEL_MIN_BYTES ( 1 << 20 ) // smaller sources are cut by one thread
+# endif
+
+# ifndef TOKEN_PROCESSOR_MAX_SHIFTS
+# define TOKEN_PROCESSOR_MAX_SHIFTS 1024 // more moves left by ReplaceLines() are applied at once
+# endif
+
+# ifndef TOKEN_PROCESSOR_MAX_LINES
+# define TOKEN_PROCESSOR_MAX_LINES UINT32_MAX // the lines held at once, as a token's line has 32 bits; see CutNextLine()
+# endif
+
+# ifndef TOKEN_PROCESSOR_STATS
+# define TOKEN_PROCESSOR_STATS 0 // 1 counts what is cut into GetStats(); 0 leaves no trace in the lexer
+# endif
+
+// What a processor has cut since it was made or ResetStats() was called; Clear() keeps it.
+// Everything stays 0 unless TOKEN_PROCESSOR_STATS is 1.
+// Lines cut again by ReplaceLines() are counted again, tokens loaded from a cache are counted as cut.
+struct TokenStats {
+    size_t typeCounts[COMMENT + 1] ; // by TokenType
+    size_t tokens ;
+    size_t bytes ;
+    size_t lines ;
+    double ioSeconds ; // getline() in CutFile() (added when it returns), mapping or reading a file or a cache, reading a stream
+    double lexSeconds ; // cutting lines
+    size_t longestToken ; // in bytes
+    size_t longestTokenLine ; // where it begins, from 0
+    size_t allocations ; // growths of the source, the lines and the token box, and new arena blocks
+    TokenStats() : tokens( 0 ), bytes( 0 ), lines( 0 ), ioSeconds( 0.0 ), lexSeconds( 0.0 ),
+                   longestToken( 0 ), longestTokenLine( 0 ), allocations( 0 ) {
+        memset( typeCounts, 0, sizeof( typeCounts ) ) ;
+    } // constructor
+} ; // struct TokenStats
+
+// Called on the cutting thread each time about another "interval" bytes have been cut.
+typedef void ( * TokenStatsCallback )( const TokenStats & stats, void * context ) ;
+
+# if TOKEN_PROCESSOR_STATS
+// Adds the time from its construction to its destruction to "seconds".
+class StatsTimer {
+
+private:
+
+    double & mSeconds ;
+    std::chrono::steady_clock::time_point mStart ;
+
+public:
+
+    explicit StatsTimer( double & seconds ) : mSeconds( seconds ), mStart( std::chrono::steady_clock::now() ) {} // constructor
+    ~StatsTimer() { mSeconds += std::chrono::duration<double>( std::chrono::steady_clock::now() - mStart ).count() ; } // destructor
+
+} ; // class StatsTimer
+# endif
+
+// What one copy of the loop of CutRange() is compiled for. The loop is picked once per line,
+// so the tables and the modes are not looked at again for every character.
+template <bool PolicyTables, bool Comments, bool CNumbers>
+struct CutRules {
+    static constexpr bool kPolicyTables = PolicyTables ; // the policy's tables, not the processor's copy
+    static constexpr bool kComments = Comments ; // not COMMENTS_OFF
+    static constexpr bool kCNumbers = CNumbers ; // NUMBERS_C
+} ; // struct CutRules
+
+// The lexer, compiled for the rules of "Policy"; see TokenPolicyV3. TokenProcessor is the usual one.
+template <class Policy>
+class BasicTokenProcessor {
+
+    friend class BasicTokenCursor<Policy> ;
+
+private:
+
+    static constexpr CharClass kPolicyScanClasses = ScanClasses( Policy::kCharClasses ) ;
+
+    CharClassTable mCharClasses ;
+    OperatorTable mOperators ;
+    bool mPolicyTables ; // neither table has been changed, so the policy's are read instead
+
+    const ScanKernels * mScanner ;
+    CharClass mScanClasses ; // the classes of mCharClasses the kernels can be used for
+
+    std::string mSource ; // every line once, each one followed by '\n'
+    MappedFile mMappedFile ; // used instead of mSource when a whole file was mapped
+    MappedFile mCacheFile ; // decoded contents loaded from a token cache point into it
+    std::string mCacheData ; // the same, where files can not be mapped
+    std::vector<LineRecord> mLines ; // empty lines too
+    TokenArena mOwnArena ;
+    TokenArena * mArena ; // decoded contents, mOwnArena unless SetArena() was called
+    SymbolTable mOwnSymbols ;
+    SymbolTable * mSymbols ; // mOwnSymbols unless SetSymbolTable() was called
+    bool mInterning ;
+    bool mDeferNumbers ;
+    int mNumberMode ;
+
+    std::vector<TokenRecord> mTokenBox ; // every token in order, see mLines for the rows
+    RecordShifts mLineShifts ; // moves of mLines not applied yet, see ReplaceLines()
+    RecordShifts mTokenShifts ; // and of mTokenBox
+    size_t mTokenIndex ;
+    size_t mTokenBase ; // tokens a stream has dropped before mTokenBox
+    size_t mMarks ; // marks not released yet, a stream keeps every token after them
+
+    TokenColumns mColumns ; // built on demand by GetColumns()
+    bool mColumnsValid ;
+
+    OutputBuffer mOutputBuffer ;
+
+    unsigned mThreadCount ;
+
+    size_t mSourceBase ; // bytes and lines a stream has dropped before mSource and mLines
+    size_t mLineBase ;
+
+    std::istream * mStream ; // NULL unless tokens are pulled from a stream
+    size_t mStreamChunkSize ;
+    size_t mStreamLexed ; // lines before this offset of mSource have been cut
+
+    int mCommentMode ;
+    int mPending ; // a comment or a literal that goes on to the next line, see ContinuePending()
+    size_t mPendingStart ;
+    size_t mPendingLine ;
+    bool mInputEnded ; // EndInput() was the last thing done to the source
+
+# if TOKEN_PROCESSOR_STATS
+    TokenStats mStats ;
+    TokenStatsCallback mStatsCallback ;
+    void * mStatsContext ;
+    size_t mStatsInterval ;
+    size_t mStatsNext ; // mStats.bytes at which mStatsCallback is called next
+    size_t mSeenCapacities[3] ; // of mSource, mLines and mTokenBox when AddStats() last looked
+    size_t mSeenBlocks ; // of mArena
+
+    void AddStats( size_t firstToken, size_t bytes, size_t lines ) ;
+# endif
+
+    template <class Rules> const CharClassTable & CharClasses() ;
+    template <class Rules> const OperatorTable & Operators() ;
+    template <class Rules> bool Scans( CharClass flag ) ;
+    template <class Rules> bool IsWhite( char ch ) ;
+    template <class Rules> bool IsDigit( char ch ) ;
+    void UpdateScanners() ;
+    int CommentMode() ;
+    int NumberMode() ;
+
+    char ChangeChar( char ch ) ;
+
+    template <class Rules>
+    TokenRecord GetLetterToken( size_t & index, const char * source, size_t length, SymbolTable * symbols ) ;
+    template <class Rules>
+    TokenRecord GetNumberToken( size_t & index, const char * source, size_t length, bool beginWithInteger ) ;
+    template <class Rules>
+    TokenRecord GetCNumberToken( size_t & index, const char * source, size_t length ) ;
+    template <class Rules>
+    TokenRecord GetDelimiterToken( size_t & index, const char * source, size_t length ) ;
+    TokenRecord GetStringToken( size_t & index, const char * source, size_t length, TokenType type,
+                                TokenArena & arena ) ;
+
+    const char * SourceData() ;
+    size_t SourceLength() ;
+    void OwnSource() ;
+    size_t LineOffset( size_t line ) ;
+    size_t LineFirstToken( size_t line ) ;
+    void ApplyShifts( size_t line = 0 ) ;
+
+    size_t ContinuationAt( const char * source, size_t index, size_t length ) ;
+    bool StringContinues( const char * source, size_t index, size_t length ) ;
+    void HoldString( size_t line, std::vector<TokenRecord> & tokenBox ) ;
+    size_t ContinuePending( size_t index, size_t length, std::vector<TokenRecord> & tokenBox, TokenArena & arena ) ;
+    void EndPending( size_t end, size_t contentsEnd, std::vector<TokenRecord> & tokenBox, TokenArena & arena ) ;
+
+    void CutRange( size_t start, size_t length, size_t line, std::vector<TokenRecord> & tokenBox, TokenArena & arena,
+                   SymbolTable * symbols ) ;
+    template <class Rules>
+    void CutRangeWith( size_t start, size_t length, size_t line, std::vector<TokenRecord> & tokenBox, TokenArena & arena,
+                       SymbolTable * symbols ) ;
+    bool CutNextLine( size_t start, size_t end ) ;
+    void CutLines( size_t start, size_t end, TokenChunk & chunk ) ;
+    bool CutBuffer( size_t start ) ;
+    bool CutBufferParallel( size_t start ) ;
+    bool LoadFile( const std::string & path, size_t & start, bool & complete ) ;
+    bool ReadFile( int fd ) ;
+    bool PullStream( size_t ahead = 0 ) ;
+
+    uint64_t SettingsHash() ;
+    bool LoadTokens( const std::string & cachePath ) ;
+    bool ParseTokens( const unsigned char * data, const unsigned char * end ) ;
+    void InternSymbols( size_t first ) ;
+
+    void BuildColumns() ;
+    TokenView MakeTokenView( const TokenRecord & record ) ;
+    TokenView MakeTokenView( size_t index ) ;
+    int GetNumber( const TokenRecord & record, int64_t & iValue, double & dValue ) ;
+    void CopyToken( const TokenView & view, TokenData & token ) ;
+    bool HoldsMark( TokenMark mark ) ;
+
+public:
+
+    BasicTokenProcessor() ; // constructor
+    BasicTokenProcessor( const std::vector<std::string> & operators ) ; // constructor
+
+    bool CutLine( const std::string & str ) ;
+    bool ReplaceLines( size_t first, size_t count, const std::vector<std::string> & newLines ) ;
+    bool CutFile( std::fstream & inFile ) ;
+    bool CutMappedFile( const std::string & path ) ;
+    void OpenStream( std::istream & inStream, size_t chunkSize = 1 << 16 ) ;
+    bool CutCachedFile( const std::string & path, const std::string & cachePath ) ;
+    bool SaveTokens( TokenSink & sink ) ;
+
+    void SetCharClass( char ch, CharClass flags ) ;
+    CharClass GetCharClass( char ch ) ;
+    bool AddOperator( const std::string & op ) ;
+    void SetThreadCount( unsigned threadCount ) ;
+    void SetArena( TokenArena * arena ) ;
+    void SetInterning( bool interning ) ;
+    void SetDeferNumbers( bool defer ) ;
+    void SetNumberMode( int mode ) ;
+    void SetSymbolTable( SymbolTable * symbols ) ;
+    SymbolTable & GetSymbolTable() ;
+    void SetScanLevel( int level ) ;
+    int GetScanLevel() ;
+    void SetCommentMode( int mode ) ;
+    void EndInput() ;
+
+    TokenStats GetStats() ;
+    void ResetStats() ;
+    void SetStatsCallback( TokenStatsCallback callback, void * context, size_t interval ) ;
+
+    bool GetToken( TokenData & token ) ;
+    bool GetToken( TokenData & token, int times ) ;
+    bool PeekToken( TokenData & token ) ;
+
+    bool GetToken( TokenView & token ) ;
+    bool GetToken( TokenView & token, int times ) ;
+    bool PeekToken( TokenView & token ) ;
+    bool PeekToken( TokenView & token, size_t ahead ) ;
+    size_t GetTokens( TokenView * tokens, size_t count ) ;
+    size_t Skip( size_t count ) ;
+    BasicTokenCursor<Policy> GetCursor() ;
+
+    TokenMark Mark() ;
+    bool Reset( TokenMark mark ) ;
+    void Release( TokenMark mark ) ;
+
+    const TokenColumns & GetColumns() ;
+
+    size_t GetLineCount() ;
+    std::string_view GetLine( size_t line ) ;
+    bool GetPosition( size_t offset, size_t & line, size_t & column ) ;
+
+    void Output( bool setBracket = true, bool setBoundary = true ) ;
+    void OutputOriginal( bool setBoundary = true ) ;
+    bool Output( TokenSink & sink, bool setBracket = true, bool setBoundary = true ) ;
+    bool OutputOriginal( TokenSink & sink, bool setBoundary = true ) ;
+
+    void Clear() ;
+    void BackToBeginning() ;
+
+} ; // class BasicTokenProcessor
+
+typedef BasicTokenProcessor<TokenPolicyV3> TokenProcessor ;
+typedef BasicTokenCursor<TokenPolicyV3> TokenCursor ;
+
+template <class Policy>
+BasicTokenProcessor<Policy>::BasicTokenProcessor() { // constructor
+
+    mCharClasses = Policy::kCharClasses ;
+    mOperators = Policy::kOperators ;
+    mPolicyTables = true ;
+
+    mScanner = SelectScanKernels( SCAN_AVX2 ) ;
+    UpdateScanners() ;
+
+    mTokenIndex = 0 ;
+    mTokenBase = mMarks = 0 ;
+    mColumnsValid = false ;
+
+    mArena = &mOwnArena ;
+    mSymbols = &mOwnSymbols ;
+    mInterning = false ;
+    mDeferNumbers = false ;
+    mNumberMode = NUMBERS_PLAIN ;
+    mThreadCount = 1 ;
+
+    mSourceBase = mLineBase = 0 ;
+
+    mStream = NULL ;
+    mStreamChunkSize = 0 ;
+    mStreamLexed = 0 ;
+
+    mCommentMode = COMMENTS_OFF ;
+    mPending = PENDING_NONE ;
+    mPendingStart = mPendingLine = 0 ;
+    mInputEnded = false ;
+
+# if TOKEN_PROCESSOR_STATS
+    mStatsCallback = NULL ;
+    mStatsContext = NULL ;
+    mStatsInterval = mStatsNext = 0 ;
+    ResetStats() ;
+# endif
+
+} // BasicTokenProcessor::BasicTokenProcessor()
+
+template <class Policy>
+BasicTokenProcessor<Policy>::BasicTokenProcessor( const std::vector<std::string> & operators ) : BasicTokenProcessor() { // constructor
+
+    const char * none[] = { NULL } ;
+    mOperators = MakeOperatorTable( none ) ;
+    mPolicyTables = false ;
+
+    for ( size_t i = 0 ; i < operators.size() ; i++ ) {
+        AddOperator( operators[i] ) ;
+    } // for
+
+} // BasicTokenProcessor::BasicTokenProcessor()
+
+// False if the processor already holds TOKEN_PROCESSOR_MAX_LINES lines; it is cleared then.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::CutLine( const std::string & str ) {
+
+    OwnSource() ;
+
+    size_t start = mSource.length() ;
+
+    mSource += str ;
+    mSource += '\n' ;
+
+# if TOKEN_PROCESSOR_STATS
+    StatsTimer timer( mStats.lexSeconds ) ;
+# endif
+    bool cut = CutNextLine( start, start + str.length() ) ;
+    mInputEnded = false ;
+    return cut ;
+
+} // BasicTokenProcessor::CutLine()
+
+// Replaces lines [first, first + count) with "newLines" (without '\n'); count 0 inserts them.
+// Only the new lines are cut again, and in comment mode the lines around them whose
+// comments or literals may have changed. They are cut alone and put in place of the old ones,
+// moving the records after them once; what the records after them say is left as it was,
+// with the move kept in mLineShifts and mTokenShifts until the records are read together.
+// Decoded contents of the tokens replaced stay in the arena until Clear().
+// Returns false for a stream, if the lines do not exist, or if there would be more than
+// TOKEN_PROCESSOR_MAX_LINES lines; nothing is changed then.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::ReplaceLines( size_t first, size_t count, const std::vector<std::string> & newLines ) {
+
+    if ( mStream != NULL || first > mLines.size() || count > mLines.size() - first ||
+         newLines.size() > TOKEN_PROCESSOR_MAX_LINES - ( mLines.size() - count ) ) {
+        return false ;
+    } // if
+
+    OwnSource() ;
+
+# if TOKEN_PROCESSOR_STATS
+    StatsTimer timer( mStats.lexSeconds ) ;
+# endif
+
+    size_t from = first ; // cutting starts at a line where nothing is open
+
+    if ( from == mLines.size() && from > 0 && CommentMode() != COMMENTS_OFF ) {
+        from-- ; // the last line may have ended open
+    } // if
+
+    while ( from > 0 && from < mLines.size() && mLines[from].pending != PENDING_NONE ) {
+        from-- ;
+    } // while
+
+    size_t lineEnd = first + count ;
+    size_t fromByte = ( from < mLines.size() ? LineOffset( from ) : mSource.length() ) ;
+    size_t startByte = ( first < mLines.size() ? LineOffset( first ) : mSource.length() ) ;
+    size_t endByte = ( lineEnd < mLines.size() ? LineOffset( lineEnd ) : mSource.length() ) ;
+    size_t keptToken = ( from < mLines.size() ? LineFirstToken( from ) : mTokenBox.size() ) ;
+    int oldPending = mPending ; // still open after the last line
+    size_t oldPendingStart = mPendingStart, oldPendingLine = mPendingLine ;
+    std::string text ;
+
+    for ( size_t i = 0 ; i < newLines.size() ; i++ ) {
+        text += newLines[i] ;
+        text += '\n' ;
+    } // for
+
+    mSource.replace( startByte, endByte - startByte, text ) ;
+
+    size_t byteDelta = text.length() - ( endByte - startByte ) ; // modulo 2^n, so it may shrink too
+
+    // the lines are cut into records of their own, swapped in, with lines numbered from "from"
+    std::vector<LineRecord> lines ;
+    std::vector<TokenRecord> tokenBox ;
+
+    mLines.swap( lines ) ;
+    mTokenBox.swap( tokenBox ) ;
+    mLineBase = from ; // for the stats
+    mPending = PENDING_NONE ;
+
+    for ( size_t start = fromByte, stop = startByte + text.length() ; start < stop ; ) {
+        size_t end = ( size_t ) ( ( const char * ) memchr( mSource.data() + start, '\n', stop - start ) - mSource.data() ) ;
+        CutNextLine( start, end ) ;
+        start = end + 1 ;
+    } // for
+
+    size_t tailLine = lineEnd ; // the lines after are cut again until nothing is open at a line start, before and now
+
+    for ( size_t start = startByte + text.length() ;
+          tailLine < lines.size() && ( mPending != PENDING_NONE || lines[tailLine].pending != PENDING_NONE ) ; ) {
+        size_t end = ( size_t ) ( ( const char * ) memchr( mSource.data() + start, '\n', mSource.length() - start ) - mSource.data() ) ;
+        CutNextLine( start, end ) ;
+        start = end + 1 ;
+        tailLine++ ;
+    } // for
+
+    if ( tailLine == lines.size() && mInputEnded ) {
+        EndInput() ;
+    } // if
+
+    mLines.swap( lines ) ;
+    mTokenBox.swap( tokenBox ) ;
+    mLineBase = 0 ;
+
+    size_t lineCount = mLines.size(), tokenCount = mTokenBox.size() ;
+    size_t oldKept = ( tailLine < lineCount ? LineFirstToken( tailLine ) : tokenCount ) ;
+    size_t tokenDelta = tokenBox.size() - ( oldKept - keptToken ) ;
+    size_t lineDelta = lines.size() - ( tailLine - from ) ;
+
+    for ( size_t i = 0 ; i < lines.size() ; i++ ) {
+        lines[i].firstToken += keptToken ;
+    } // for
+
+    for ( size_t i = 0 ; i < tokenBox.size() ; i++ ) {
+        tokenBox[i].line += ( uint32_t ) from ;
+    } // for
+
+    SpliceRecords( mLines, from, tailLine, lines ) ;
+    SpliceRecords( mTokenBox, keptToken, oldKept, tokenBox ) ;
+    mLineShifts.Replace( from, tailLine, from + lines.size(), lineCount, byteDelta, tokenDelta ) ;
+    mTokenShifts.Replace( keptToken, oldKept, keptToken + tokenBox.size(), tokenCount, byteDelta, lineDelta ) ;
+    mColumnsValid = false ;
+
+    if ( mLineShifts.size() + mTokenShifts.size() > TOKEN_PROCESSOR_MAX_SHIFTS ) {
+        ApplyShifts() ;
+    } // if
+
+    if ( tailLine < lineCount && oldPending != PENDING_NONE ) { // it began in the lines moved
+        mPending = oldPending ;
+        mPendingStart = oldPendingStart + byteDelta ;
+        mPendingLine = oldPendingLine + lineDelta ;
+    } // if
+    else if ( mPending != PENDING_NONE ) { // it began in the lines cut
+        mPendingLine += from ;
+    } // else if
+    else {
+        ;
+    } // else
+
+    if ( mPending != PENDING_NONE ) {
+        ApplyShifts( mPendingLine ) ; // EndPending() writes to the lines after it, and adds its token
+    } // if
+
+    if ( mTokenIndex >= oldKept ) { // the cursor stays on the same token, or on the first one cut again
+        mTokenIndex += tokenDelta ;
+    } // if
+    else if ( mTokenIndex > keptToken ) {
+        mTokenIndex = keptToken ;
+    } // else if
+    else {
+        ;
+    } // else
+
+    return true ;
+
+} // BasicTokenProcessor::ReplaceLines()
+
+// False, with the processor cleared, if the file has more lines than CutLine() takes.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::CutFile( std::fstream & inFile ) {
+
+    std::string line = "" ;
+    bool cut = true ;
+
+# if TOKEN_PROCESSOR_STATS
+    // the loop is timed once, less what CutLine() timed: timing each getline() costs about as much as it
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now() ;
+    double lexSeconds = mStats.lexSeconds ;
+# endif
+
+    while ( cut && getline( inFile, line ) ) {
+        cut = CutLine( line ) ;
+    } // while
+
+# if TOKEN_PROCESSOR_STATS
+    mStats.ioSeconds += std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() -
+                        ( mStats.lexSeconds - lexSeconds ) ;
+# endif
+
+    if ( !cut ) {
+        return false ;
+    } // if
+
+    EndInput() ;
+    return true ;
+
+} // BasicTokenProcessor::CutFile()
+
+// False if the file can not be opened, and nothing is changed then. False too if it can not be
+// read whole, or has more lines than CutLine() takes; the processor is cleared then, so the tokens
+// of part of a file are never taken for those of the file.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::CutMappedFile( const std::string & path ) {
+
+    size_t start = 0 ;
+    bool complete = true ;
+
+    if ( !LoadFile( path, start, complete ) ) {
+        return false ;
+    } // if
+    else if ( !complete ) {
+        Clear() ;
+        return false ;
+    } // else if
+    else {
+        return CutBuffer( start ) ;
+    } // else
+
+} // BasicTokenProcessor::CutMappedFile()
+
+// Puts a whole file after the contents held without cutting it: mapped if nothing is held yet,
+// read otherwise. "start" is where it begins; "complete" is false if reading it failed halfway.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::LoadFile( const std::string & path, size_t & start, bool & complete ) {
+
+    complete = true ;
+
+# if TOKEN_PROCESSOR_STATS
+    StatsTimer timer( mStats.ioSeconds ) ;
+# endif
+
+# if TOKEN_PROCESSOR_HAS_MMAP
+    int fd = open( path.c_str(), O_RDONLY ) ;
+
+    if ( fd < 0 ) {
+        return false ;
+    } // if
+
+    struct stat status ;
+
+    if ( fstat( fd, &status ) == 0 && S_ISREG( status.st_mode ) &&
+         mLines.empty() && mMappedFile.Data() == NULL ) {
+
+        if ( status.st_size == 0 ) {
+            close( fd ) ;
+            start = SourceLength() ;
+            return true ;
+        } // if
+        else if ( mMappedFile.Map( fd, ( size_t ) status.st_size ) ) {
+            close( fd ) ;
+            start = 0 ; // tokenize directly out of the mapping
+            return true ;
+        } // else if
+        else {
+            ; // can not be mapped, read it instead
+        } // else
+
+    } // if
+
+    OwnSource() ;
+    start = mSource.length() ;
+    complete = ReadFile( fd ) ; // pipes, devices, or appending to existing contents
+    close( fd ) ;
+    return true ;
+# else
+    std::ifstream inFile( path.c_str(), std::ios::in | std::ios::binary ) ;
+
+    if ( !inFile ) {
+        return false ;
+    } // if
+
+    OwnSource() ;
+
+    start = mSource.length() ;
+    const size_t blockSize = 1 << 20 ;
+
+    do {
+        size_t used = mSource.length() ;
+        mSource.resize( used + blockSize ) ;
+        inFile.read( &mSource[used], blockSize ) ;
+        mSource.resize( used + ( size_t ) inFile.gcount() ) ;
+    } while ( inFile ) ;
+
+    if ( mSource.length() > start && mSource[mSource.length() - 1] != '\n' ) {
+        mSource += '\n' ;
+    } // if
+
+    return true ;
+# endif
+
+} // BasicTokenProcessor::LoadFile()
+
+// Like CutMappedFile(), but the tokens come from "cachePath" if it was saved for the same
+// contents and the same settings; otherwise the file is cut and the cache is written again.
+// Only a processor holding nothing uses the cache.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::CutCachedFile( const std::string & path, const std::string & cachePath ) {
+
+    if ( !mLines.empty() || mStream != NULL ) {
+        return CutMappedFile( path ) ;
+    } // if
+
+    size_t start = 0 ;
+    bool complete = true ;
+
+    if ( !LoadFile( path, start, complete ) ) {
+        return false ;
+    } // if
+    else if ( !complete ) { // as CutMappedFile() does, and no cache is written
+        Clear() ;
+        return false ;
+    } // else if
+    else if ( LoadTokens( cachePath ) ) {
+        if ( mInterning ) { // ids belong to the table, not to the cache
+            InternSymbols( 0 ) ;
+        } // if
+# if TOKEN_PROCESSOR_STATS
+        AddStats( 0, SourceLength(), mLines.size() ) ;
+# endif
+        return true ;
+    } // else if
+    else if ( !CutBuffer( start ) ) {
+        return false ;
+    } // else if
+    else {
+        ;
+    } // else
+
+    // written aside first, so a reader never sees half a cache
+    std::string temporary = TemporaryPath( cachePath ) ;
+    std::ofstream outFile( temporary.c_str(), std::ios::out | std::ios::binary | std::ios::trunc ) ;
+    StreamSink sink( outFile ) ;
+    bool written = outFile && SaveTokens( sink ) ;
+
+    outFile.close() ;
+    if ( !written || std::rename( temporary.c_str(), cachePath.c_str() ) != 0 ) {
+        std::remove( temporary.c_str() ) ;
+    } // if
+
+    return true ;
+
+} // BasicTokenProcessor::CutCachedFile()
+
+// Everything that changes how a source is cut.
+template <class Policy>
+uint64_t BasicTokenProcessor<Policy>::SettingsHash() {
+
+    uint64_t hash = HashBytes( ( const char * ) mCharClasses.flags, sizeof( mCharClasses.flags ), TOKEN_CACHE_VERSION ) ;
+
+    hash = HashBytes( ( const char * ) mOperators.column, sizeof( mOperators.column ), hash ) ;
+    hash = HashBytes( ( const char * ) mOperators.next, sizeof( mOperators.next ), hash ) ;
+    hash = HashBytes( ( const char * ) mOperators.accept, sizeof( mOperators.accept ), hash ) ;
+    hash = HashBytes( Policy::kEscapes.to, sizeof( Policy::kEscapes.to ), hash ) ;
+    hash ^= ( uint64_t ) ( Policy::kStringQuote & 0xFFFF ) << 16 | ( uint64_t ) ( Policy::kCharQuote & 0xFFFF ) << 32 |
+            ( uint64_t ) Policy::kDoubles << 48 | ( uint64_t ) Policy::kLeadingDot << 49 ;
+    return hash ^ ( uint64_t ) CommentMode() ^ ( ( uint64_t ) NumberMode() << 8 ) ;
+
+} // BasicTokenProcessor::SettingsHash()
+
+// Writes the source length and hash, the settings hash, and every token and line held,
+// in the format described at TOKEN_CACHE_VERSION. A stream can not be saved.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::SaveTokens( TokenSink & sink ) {
+
+    if ( mStream != NULL || mPending != PENDING_NONE ) {
+        return false ;
+    } // if
+
+    ApplyShifts() ;
+
+    std::vector<uint64_t> numbers ;
+    std::vector<std::string_view> strings ;
+    std::vector<uint32_t> references( mTokenBox.size() ) ; // number or string index of each token
+    std::vector<uint8_t> numberFlags( mTokenBox.size() ) ;
+    std::unordered_map<uint64_t, uint32_t> numberIndexes ;
+    std::unordered_map<std::string_view, uint32_t> stringIndexes ;
+
+    for ( size_t i = 0 ; i < mTokenBox.size() ; i++ ) {
+
+        const TokenRecord & record = mTokenBox[i] ;
+
+        if ( record.type < 0 || record.type > 0x0F ) {
+            return false ;
+        } // if
+        else if ( record.type == INTEGER || record.type == DOUBLE ) {
+
+            uint64_t bits = 0 ;
+            int64_t iValue = 0 ;
+            double dValue = 0.0 ;
+
+            numberFlags[i] = ( uint8_t ) GetNumber( record, iValue, dValue ) ;
+
+            if ( record.type == INTEGER ) {
+                bits = ( uint64_t ) iValue ;
+            } // if
+            else {
+                memcpy( &bits, &dValue, sizeof( bits ) ) ;
+            } // else
+
+            auto found = numberIndexes.emplace( bits, ( uint32_t ) numbers.size() ) ;
+            if ( found.second ) {
+                numbers.push_back( bits ) ;
+            } // if
+
+            references[i] = found.first->second ;
+
+        } // if
+        else if ( record.decodedContents != NULL ) {
+
+            std::string_view contents( record.decodedContents, record.contentsLength ) ;
+            auto found = stringIndexes.emplace( contents, ( uint32_t ) strings.size() ) ;
+            if ( found.second ) {
+                strings.push_back( contents ) ;
+            } // if
+
+            references[i] = found.first->second ;
+
+        } // else if
+        else {
+            ;
+        } // else
+
+    } // for
+
+    char buffer[24] ;
+    MemorySink payload ; // the header keeps its hash, so it is put together first
+
+    mOutputBuffer.Begin( payload ) ;
+    mOutputBuffer.Append( buffer, PutVarint( buffer, numbers.size() ) ) ;
+
+    for ( size_t i = 0 ; i < numbers.size() ; i++ ) {
+        for ( int j = 0 ; j < 8 ; j++ ) {
+            buffer[j] = ( char ) ( numbers[i] >> ( 8 * j ) ) ;
+        } // for
+        mOutputBuffer.Append( buffer, 8 ) ;
+    } // for
+
+    mOutputBuffer.Append( buffer, PutVarint( buffer, strings.size() ) ) ;
+
+    for ( size_t i = 0 ; i < strings.size() ; i++ ) {
+        mOutputBuffer.Append( buffer, PutVarint( buffer, strings[i].length() ) ) ;
+        mOutputBuffer.Append( strings[i] ) ;
+    } // for
+
+    mOutputBuffer.Append( buffer, PutVarint( buffer, mLines.size() ) ) ;
+
+    for ( size_t i = 0 ; i < mLines.size() ; i++ ) {
+        mOutputBuffer.Append( buffer, PutVarint( buffer, mLines[i].offset - ( i > 0 ? mLines[i - 1].offset : 0 ) ) ) ;
+        mOutputBuffer.Append( buffer, PutVarint( buffer, mLines[i].firstToken - ( i > 0 ? mLines[i - 1].firstToken : 0 ) ) ) ;
+        mOutputBuffer.Append( ( char ) mLines[i].pending ) ;
+    } // for
+
+    mOutputBuffer.Append( buffer, PutVarint( buffer, mTokenBox.size() ) ) ;
+
+    size_t previousEnd = 0, previousLine = 0 ;
+
+    for ( size_t i = 0 ; i < mTokenBox.size() ; i++ ) {
+
+        const TokenRecord & record = mTokenBox[i] ;
+        size_t lineDelta = record.line - previousLine ;
+
+        mOutputBuffer.Append( ( char ) ( record.type | ( lineDelta < 15 ? lineDelta : 15 ) << 4 ) ) ;
+        if ( lineDelta >= 15 ) {
+            mOutputBuffer.Append( buffer, PutVarint( buffer, lineDelta ) ) ;
+        } // if
+
+        mOutputBuffer.Append( buffer, PutVarint( buffer, record.offset - previousEnd ) ) ;
+        mOutputBuffer.Append( buffer, PutVarint( buffer, record.length ) ) ;
+        previousEnd = record.offset + record.length ;
+        previousLine = record.line ;
+
+        if ( record.type == INTEGER || record.type == DOUBLE ) {
+            mOutputBuffer.Append( buffer, PutVarint( buffer, references[i] ) ) ;
+            mOutputBuffer.Append( ( char ) numberFlags[i] ) ;
+        } // if
+        else if ( record.decodedContents != NULL ) {
+            mOutputBuffer.Append( buffer, PutVarint( buffer, ( uint64_t ) references[i] + 1 ) ) ;
+        } // else if
+        else if ( record.type == STRING || record.type == CHAR ) {
+            mOutputBuffer.Append( '\0' ) ;
+            mOutputBuffer.Append( buffer, PutVarint( buffer, record.contentsLength ) ) ;
+        } // else if
+        else {
+            ;
+        } // else
+
+    } // for
+
+    mOutputBuffer.End() ;
+
+    uint64_t hashes[3] = { HashBytes( SourceData(), SourceLength(), 0 ), SettingsHash(),
+                           HashBytes( payload.Data().data(), payload.Data().length(), 0 ) } ;
+
+    mOutputBuffer.Begin( sink ) ;
+    mOutputBuffer.Append( "TPKC" ) ;
+    mOutputBuffer.Append( ( char ) TOKEN_CACHE_VERSION ) ;
+    mOutputBuffer.Append( buffer, PutVarint( buffer, SourceLength() ) ) ;
+
+    for ( int i = 0 ; i < 24 ; i++ ) {
+        buffer[i] = ( char ) ( hashes[i / 8] >> ( 8 * ( i % 8 ) ) ) ;
+    } // for
+
+    mOutputBuffer.Append( buffer, 24 ) ;
+    mOutputBuffer.Append( payload.Data() ) ;
+    return mOutputBuffer.End() ;
+
+} // BasicTokenProcessor::SaveTokens()
+
+// Takes the tokens from a cache saved for the source held and the settings in use.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::LoadTokens( const std::string & cachePath ) {
+
+# if TOKEN_PROCESSOR_STATS
+    StatsTimer timer( mStats.ioSeconds ) ;
+# endif
+
+    const char * data = NULL ;
+    size_t length = 0 ;
+
+# if TOKEN_PROCESSOR_HAS_MMAP
+    int fd = open( cachePath.c_str(), O_RDONLY ) ;
+
+    if ( fd < 0 ) {
+        return false ;
+    } // if
+
+    struct stat status ;
+    bool mapped = ( fstat( fd, &status ) == 0 && S_ISREG( status.st_mode ) && status.st_size > 0 &&
+                    mCacheFile.Map( fd, ( size_t ) status.st_size ) ) ;
+
+    close( fd ) ;
+
+    if ( !mapped ) {
+        return false ;
+    } // if
+
+    data = mCacheFile.Data() ;
+    length = mCacheFile.Length() ;
+# else
+    std::ifstream inFile( cachePath.c_str(), std::ios::in | std::ios::binary ) ;
+
+    if ( !inFile ) {
+        return false ;
+    } // if
+
+    mCacheData.assign( std::istreambuf_iterator<char>( inFile ), std::istreambuf_iterator<char>() ) ;
+    data = mCacheData.data() ;
+    length = mCacheData.length() ;
+# endif
+
+    if ( ParseTokens( ( const unsigned char * ) data, ( const unsigned char * ) data + length ) ) {
+        mInputEnded = true ;
+        return true ;
+    } // if
+
+    mLines.clear() ;
+    mTokenBox.clear() ;
+    mCacheFile.Unmap() ;
+    mCacheData.clear() ;
+    return false ;
+
+} // BasicTokenProcessor::LoadTokens()
+
+// Fills mLines and mTokenBox from a cache in [data, end), whose decoded contents stay where they are
+// until Clear(); false if it does not fit the source held.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::ParseTokens( const unsigned char * data, const unsigned char * end ) {
+
+    size_t sourceLength = SourceLength() ;
+    uint64_t value = 0 ;
+
+    if ( end - data < 5 || memcmp( data, "TPKC", 4 ) != 0 || data[4] != TOKEN_CACHE_VERSION ) {
+        return false ;
+    } // if
+
+    data += 5 ;
+
+    if ( !GetVarint( data, end, value ) || value != sourceLength || end - data < 24 ) {
+        return false ;
+    } // if
+
+    uint64_t sourceHash = LittleEndianWord( ( const char * ) data ) ;
+    uint64_t settingsHash = LittleEndianWord( ( const char * ) data + 8 ) ;
+    uint64_t payloadHash = LittleEndianWord( ( const char * ) data + 16 ) ;
+
+    data += 24 ;
+
+    // a byte changed in bounds would still make records that fit, so nothing is read unless all match
+    if ( settingsHash != SettingsHash() || sourceHash != HashBytes( SourceData(), sourceLength, 0 ) ||
+         payloadHash != HashBytes( ( const char * ) data, ( size_t ) ( end - data ), 0 ) ) {
+        return false ;
+    } // if
+
+    std::vector<const unsigned char *> numbers, strings ;
+    std::vector<size_t> stringLengths ;
+
+    // every count is checked against the bytes left before anything is reserved for it
+    if ( !GetVarint( data, end, value ) || value > ( uint64_t ) ( end - data ) / 8 ) {
+        return false ;
+    } // if
+
+    for ( uint64_t i = 0 ; i < value ; i++, data += 8 ) {
+        numbers.push_back( data ) ;
+    } // for
+
+    if ( !GetVarint( data, end, value ) || value > ( uint64_t ) ( end - data ) ) {
+        return false ;
+    } // if
+
+    for ( uint64_t i = 0, count = value ; i < count ; i++ ) {
+
+        if ( !GetVarint( data, end, value ) || value > ( uint64_t ) ( end - data ) ) {
+            return false ;
+        } // if
+
+        strings.push_back( data ) ;
+        stringLengths.push_back( ( size_t ) value ) ;
+        data += value ;
+
+    } // for
+
+    if ( !GetVarint( data, end, value ) || value > ( uint64_t ) ( end - data ) / 3 || value > TOKEN_PROCESSOR_MAX_LINES ) {
+        return false ;
+    } // if
+
+    size_t offset = 0, firstToken = 0 ;
+    uint64_t tokenDelta = 0 ;
+
+    mLines.reserve( ( size_t ) value ) ;
+
+    for ( uint64_t i = 0, count = value ; i < count ; i++ ) {
+
+        if ( !GetVarint( data, end, value ) || !GetVarint( data, end, tokenDelta ) || data >= end ||
+             value > sourceLength - offset || tokenDelta > ( uint64_t ) ( end - data ) ||
+             *data > PENDING_CHAR ) {
+            return false ;
+        } // if
+
+        offset += ( size_t ) value ;
+        firstToken += ( size_t ) tokenDelta ;
+        mLines.push_back( LineRecord( offset, firstToken, *data++ ) ) ;
+
+    } // for
+
+    if ( !GetVarint( data, end, value ) || value > ( uint64_t ) ( end - data ) / 3 || firstToken > value ) {
+        return false ;
+    } // if
+
+    const int numberMask = NUMBER_OVERFLOW | NUMBER_UNDERFLOW | NUMBER_MALFORMED | NUMBER_UNSIGNED |
+                           NUMBER_LONG | NUMBER_LONG_LONG | NUMBER_FLOAT ;
+    uint64_t length = 0, lineDelta = 0 ;
+    size_t line = 0, nextToken = 0 ; // the first token of the line after "line"
+
+    offset = 0 ;
+    mTokenBox.reserve( ( size_t ) value ) ;
+
+    for ( uint64_t i = 0, count = value ; i < count ; i++ ) {
+
+        if ( data >= end ) {
+            return false ;
+        } // if
+
+        TokenType type = *data & 0x0F ;
+
+        lineDelta = *data++ >> 4 ;
+        if ( lineDelta == 15 && !GetVarint( data, end, lineDelta ) ) {
+            return false ;
+        } // if
+
+        if ( type < UNKNOWN || type > COMMENT || lineDelta >= mLines.size() - line ||
+             !GetVarint( data, end, value ) || value > sourceLength - offset ) {
+            return false ;
+        } // if
+
+        offset += ( size_t ) value ; // the end of the previous token, then its start
+        line += ( size_t ) lineDelta ;
+        nextToken = ( line + 1 < mLines.size() ? mLines[line + 1].firstToken : ( size_t ) count ) ;
+
+        // the token is one of its line's
+        if ( !GetVarint( data, end, length ) || length > sourceLength - offset ||
+             i < mLines[line].firstToken || i >= nextToken || offset < mLines[line].offset ) {
+            return false ;
+        } // if
+
+        TokenRecord record( offset, ( size_t ) length, 0, 0.0, type ) ;
+        record.line = ( uint32_t ) line ;
+
+        if ( type == INTEGER || type == DOUBLE ) {
+
+            if ( !GetVarint( data, end, value ) || value >= numbers.size() ||
+                 data >= end || ( *data & ~numberMask ) != 0 ) {
+                return false ;
+            } // if
+
+            uint64_t bits = LittleEndianWord( ( const char * ) numbers[( size_t ) value] ) ;
+
+            if ( type == INTEGER ) {
+                record.iValue = ( int64_t ) bits ;
+            } // if
+            else {
+                memcpy( &record.dValue, &bits, sizeof( bits ) ) ;
+            } // else
+
+            record.numberFlags = *data++ ;
+
+        } // if
+        else if ( type == STRING || type == CHAR ) {
+
+            if ( !GetVarint( data, end, value ) || value > strings.size() ) {
+                return false ;
+            } // if
+
+            record.contentsOffset = offset + 1 ;
+
+            if ( value > 0 ) {
+                record.decodedContents = ( const char * ) strings[( size_t ) value - 1] ;
+                record.contentsLength = stringLengths[( size_t ) value - 1] ;
+            } // if
+            else if ( !GetVarint( data, end, value ) || value >= length ) { // inside the token, after its quote
+                return false ;
+            } // else if
+            else {
+                record.contentsLength = ( size_t ) value ;
+            } // else
+
+        } // else if
+        else {
+            ;
+        } // else
+
+        mTokenBox.push_back( record ) ;
+        offset += ( size_t ) length ;
+
+    } // for
+
+    mColumnsValid = false ;
+    return data == end ;
+
+} // BasicTokenProcessor::ParseTokens()
+
+// Tokens are cut lazily while GetToken() and PeekToken() consume them, and the lines
+// already consumed are dropped, so only about one chunk is held at a time.
+// CutLine(), CutFile() and CutMappedFile() should not be used until the stream ends.
+template <class Policy>
+void BasicTokenProcessor<Policy>::OpenStream( std::istream & inStream, size_t chunkSize ) {
+
+    Clear() ;
+
+    mStream = &inStream ;
+    mStreamChunkSize = ( chunkSize != 0 ? chunkSize : 1 ) ;
+
+} // BasicTokenProcessor::OpenStream()
+
+// Cuts lines of the stream until the token after the next "ahead" ones is held.
+// The lines are dropped first if every token held has been consumed; their bytes only once
+// there are a chunk of them, so that each byte is moved about once however short the lines are.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::PullStream( size_t ahead ) {
+
+    if ( mStream == NULL ) {
+        return false ;
+    } // if
+    else if ( mTokenIndex < mTokenBox.size() || mMarks > 0 ) {
+        ; // unread or marked tokens are kept, more are cut after them
+    } // else if
+    else {
+
+        // every token held has been consumed, keep only the lines of a comment or a literal
+        // that is still open, and the bytes not cut yet
+        size_t drop = mStreamLexed, dropLine = mLines.size() ;
+
+        if ( mPending != PENDING_NONE ) {
+            drop = mLines[mPendingLine].offset ;
+            dropLine = mPendingLine ;
+            mPendingLine = 0 ;
+        } // if
+
+        if ( drop < mStreamChunkSize ) {
+            drop = 0 ; // the lines go, their bytes stay until later
+        } // if
+
+        mSource.erase( 0, drop ) ;
+        mSourceBase += drop ;
+        mStreamLexed -= drop ;
+        mPendingStart -= ( mPending != PENDING_NONE ? drop : 0 ) ;
+        mLineBase += dropLine ;
+        mLines.erase( mLines.begin(), mLines.begin() + dropLine ) ;
+
+        for ( size_t i = 0 ; i < mLines.size() ; i++ ) {
+            mLines[i].offset -= drop ;
+            mLines[i].firstToken = 0 ;
+        } // for
+
+        mTokenBase += mTokenBox.size() ;
+        mTokenBox.clear() ;
+        mTokenIndex = 0 ;
+        mColumnsValid = false ;
+
+        if ( mArena == &mOwnArena ) {
+            mArena->Reset() ;
+        } // if
+
+    } // else
+
+    while ( mTokenBox.size() - mTokenIndex <= ahead ) {
+
+        const char * newline = ( const char * ) memchr( mSource.data() + mStreamLexed, '\n',
+                                                        mSource.length() - mStreamLexed ) ;
+
+        if ( newline != NULL ) { // a whole line
+            size_t end = ( size_t ) ( newline - mSource.data() ) ;
+# if TOKEN_PROCESSOR_STATS
+            StatsTimer timer( mStats.lexSeconds ) ;
+# endif
+            if ( !CutNextLine( mStreamLexed, end ) ) {
+                return false ;
+            } // if
+            mStreamLexed = end + 1 ;
+        } // if
+        else if ( *mStream ) {
+# if TOKEN_PROCESSOR_STATS
+            StatsTimer timer( mStats.ioSeconds ) ;
+# endif
+            size_t used = mSource.length() ;
+            mSource.resize( used + mStreamChunkSize ) ;
+            mStream->read( &mSource[used], ( std::streamsize ) mStreamChunkSize ) ;
+            mSource.resize( used + ( size_t ) mStream->gcount() ) ;
+        } // else if
+        else { // the stream ends
+
+            if ( mStreamLexed < mSource.length() ) { // the last line has no '\n'
+                mSource += '\n' ;
+            } // if
+            else if ( mPending != PENDING_NONE ) {
+                EndInput() ;
+            } // else if
+            else {
+                mStream = NULL ;
+                return false ;
+            } // else
+
+        } // else
+
+    } // while
+
+    return true ;
+
+} // BasicTokenProcessor::PullStream()
+
+// Appends everything left in "fd" to mSource, not cut yet.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::ReadFile( int fd ) {
+
+# if TOKEN_PROCESSOR_HAS_MMAP
+    size_t start = mSource.length() ;
+    const size_t blockSize = 1 << 20 ;
+    bool successOrNot = true ;
+
+    while ( true ) {
+
+        size_t used = mSource.length() ;
+        mSource.resize( used + blockSize ) ;
+
+        ssize_t count = read( fd, &mSource[used], blockSize ) ;
+
+        mSource.resize( used + ( count > 0 ? ( size_t ) count : 0 ) ) ;
+
+        if ( count == 0 ) {
+            break ;
+        } // if
+        else if ( count < 0 && errno != EINTR ) {
+            successOrNot = false ;
+            break ;
+        } // else if
+        else {
+            ;
+        } // else
+
+    } // while
+
+    if ( mSource.length() > start && mSource[mSource.length() - 1] != '\n' ) {
+        mSource += '\n' ;
+    } // if
+
+    return successOrNot ;
+# else
+    ( void ) fd ;
+    return false ;
+# endif
+
+} // BasicTokenProcessor::ReadFile()
+
+// The end of the buffer ends the input: a comment left open there ends with it.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::CutBuffer( size_t start ) {
+
+# if TOKEN_PROCESSOR_STATS
+    StatsTimer timer( mStats.lexSeconds ) ;
+# endif
+
+    // a comment can hide any line from the next, so comment mode cuts in order
+    if ( mThreadCount > 1 && SourceLength() - start >= TOKEN_PROCESSOR_PARALLEL_MIN_BYTES &&
+         CommentMode() == COMMENTS_OFF && mPending == PENDING_NONE ) {
+        return CutBufferParallel( start ) ;
+    } // if
+
+    const char * source = SourceData() ;
+    size_t length = SourceLength() ;
+
+    while ( start < length ) {
+
+        const char * newline = ( const char * ) memchr( source + start, '\n', length - start ) ;
+        size_t end = ( newline != NULL ? ( size_t ) ( newline - source ) : length ) ;
+
+        if ( !CutNextLine( start, end ) ) {
+            return false ;
+        } // if
+
+        start = end + 1 ;
+
+    } // while
+
+    EndInput() ;
+    return true ;
+
+} // BasicTokenProcessor::CutBuffer()
+
+// Splits the source at line starts into a few pieces per thread, cuts the pieces on
+// mThreadCount threads and appends them in their original order.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::CutBufferParallel( size_t start ) {
+
+    const char * source = SourceData() ;
+    size_t length = SourceLength() ;
+    size_t pieceCount = ( size_t ) mThreadCount * 4 ;
+
+    std::vector<size_t> bounds ;
+    bounds.push_back( start ) ;
+
+    for ( size_t i = 1 ; i < pieceCount ; i++ ) {
+
+        size_t position = start + ( length - start ) / pieceCount * i ;
+
+        if ( position > bounds.back() ) {
+
+            const char * newline = ( const char * ) memchr( source + position, '\n', length - position ) ;
+
+            if ( newline == NULL ) {
+                break ;
+            } // if
+            else if ( ( size_t ) ( newline - source ) + 1 < length ) {
+                bounds.push_back( ( size_t ) ( newline - source ) + 1 ) ;
+            } // else if
+            else {
+                ;
+            } // else
+
+        } // if
+
+    } // for
+
+    bounds.push_back( length ) ;
+
+    std::vector<TokenChunk> chunks( bounds.size() - 1 ) ;
+    std::atomic<size_t> nextChunk( 0 ) ;
+
+    auto work = [&]() {
+        for ( size_t i = nextChunk++ ; i < chunks.size() ; i = nextChunk++ ) {
+            CutLines( bounds[i], bounds[i + 1], chunks[i] ) ;
+        } // for
+    } ; // work
+
+    std::vector<std::thread> threads ;
+
+    for ( unsigned i = 1 ; i < mThreadCount && i < chunks.size() ; i++ ) {
+        threads.push_back( std::thread( work ) ) ;
+    } // for
+
+    work() ;
+
+    for ( size_t i = 0 ; i < threads.size() ; i++ ) {
+        threads[i].join() ;
+    } // for
+
+    size_t tokenCount = mTokenBox.size(), firstToken = mTokenBox.size() ;
+    size_t lineCount = mLines.size() ;
+# if TOKEN_PROCESSOR_STATS
+    size_t firstLine = mLines.size() ;
+# endif
+
+    for ( size_t i = 0 ; i < chunks.size() ; i++ ) {
+        tokenCount += chunks[i].tokenBox.size() ;
+        lineCount += chunks[i].lines.size() ;
+    } // for
+
+    if ( lineCount > TOKEN_PROCESSOR_MAX_LINES ) { // as CutNextLine() refuses them
+        Clear() ;
+        return false ;
+    } // if
+
+    mTokenBox.reserve( tokenCount ) ;
+    mColumnsValid = false ;
+
+    for ( size_t i = 0 ; i < chunks.size() ; i++ ) {
+
+        size_t tokenBase = mTokenBox.size(), lineBase = mLines.size() ;
+
+        for ( size_t j = 0 ; j < chunks[i].lines.size() ; j++ ) {
+            mLines.push_back( LineRecord( chunks[i].lines[j].offset, chunks[i].lines[j].firstToken + tokenBase ) ) ;
+        } // for
+
+        for ( size_t j = 0 ; j < chunks[i].tokenBox.size() ; j++ ) {
+            chunks[i].tokenBox[j].line += ( uint32_t ) lineBase ;
+        } // for
+
+        mTokenBox.insert( mTokenBox.end(), chunks[i].tokenBox.begin(), chunks[i].tokenBox.end() ) ;
+        mArena->Adopt( chunks[i].arena ) ; // decoded contents stay where the piece put them
+
+    } // for
+
+    if ( mInterning ) { // in order, so the ids are the ones one thread would give
+        InternSymbols( firstToken ) ;
+    } // if
+
+# if TOKEN_PROCESSOR_STATS
+    AddStats( firstToken, length - start, mLines.size() - firstLine ) ;
+# endif
+
+    EndInput() ; // as CutBuffer() does, the end of the buffer ends the input
+    return true ;
+
+} // BasicTokenProcessor::CutBufferParallel()
+
+// Cuts the lines of source[start, end) into "chunk"; "end" is a line start or the end of the source.
+template <class Policy>
+void BasicTokenProcessor<Policy>::CutLines( size_t start, size_t end, TokenChunk & chunk ) {
+
+    const char * source = SourceData() ;
+
+    while ( start < end ) {
+
+        const char * newline = ( const char * ) memchr( source + start, '\n', end - start ) ;
+        size_t lineEnd = ( newline != NULL ? ( size_t ) ( newline - source ) : end ) ;
+
+        chunk.lines.push_back( LineRecord( start, chunk.tokenBox.size() ) ) ;
+        CutRange( start, lineEnd, chunk.lines.size() - 1, chunk.tokenBox, chunk.arena, NULL ) ;
+        start = lineEnd + 1 ;
+
+    } // while
+
+} // BasicTokenProcessor::CutLines()
+
+// Cuts source[start, end), a whole line, as the last line of the processor.
+// Every way of cutting adds its lines here, or refuses as many: the processor is cleared and false
+// returned instead of numbering a line TOKEN_PROCESSOR_MAX_LINES, past what a token's line holds.
+// A token's line counts from the first line held, so a stream, which drops the lines it has given,
+// is only refused when its window holds that many; its lines are numbered on past them.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::CutNextLine( size_t start, size_t end ) {
+
+    if ( mLines.size() >= TOKEN_PROCESSOR_MAX_LINES ) {
+        Clear() ;
+        return false ;
+    } // if
+
+    mColumnsValid = false ;
+    mLines.push_back( LineRecord( start, mTokenBox.size(), mPending ) ) ;
+    CutRange( start, end, mLines.size() - 1, mTokenBox, *mArena, mInterning ? mSymbols : NULL ) ;
+# if TOKEN_PROCESSOR_STATS
+    AddStats( mLines.back().firstToken, ( end < SourceLength() ? end + 1 : end ) - start, 1 ) ;
+# endif
+    return true ;
+
+} // BasicTokenProcessor::CutNextLine()
+
+// "symbols" is where identifiers are interned, NULL to leave them for InternSymbols().
+// The loop is the one compiled for the tables and modes in use; a mode the policy fixes is a constant,
+// so only its loops are called.
+template <class Policy>
+void BasicTokenProcessor<Policy>::CutRange( size_t start, size_t length, size_t line, std::vector<TokenRecord> & tokenBox,
+                                            TokenArena & arena, SymbolTable * symbols ) {
+
+    bool comments = ( CommentMode() != COMMENTS_OFF ), cNumbers = ( NumberMode() == NUMBERS_C ) ;
+
+    if ( mPolicyTables && !comments && !cNumbers ) {
+        CutRangeWith< CutRules<true, false, false> >( start, length, line, tokenBox, arena, symbols ) ;
+    } // if
+    else if ( mPolicyTables && !comments ) {
+        CutRangeWith< CutRules<true, false, true> >( start, length, line, tokenBox, arena, symbols ) ;
+    } // else if
+    else if ( mPolicyTables && !cNumbers ) {
+        CutRangeWith< CutRules<true, true, false> >( start, length, line, tokenBox, arena, symbols ) ;
+    } // else if
+    else if ( mPolicyTables ) {
+        CutRangeWith< CutRules<true, true, true> >( start, length, line, tokenBox, arena, symbols ) ;
+    } // else if
+    else if ( !comments && !cNumbers ) {
+        CutRangeWith< CutRules<false, false, false> >( start, length, line, tokenBox, arena, symbols ) ;
+    } // else if
+    else if ( !comments ) {
+        CutRangeWith< CutRules<false, false, true> >( start, length, line, tokenBox, arena, symbols ) ;
+    } // else if
+    else if ( !cNumbers ) {
+        CutRangeWith< CutRules<false, true, false> >( start, length, line, tokenBox, arena, symbols ) ;
+    } // else if
+    else {
+        CutRangeWith< CutRules<false, true, true> >( start, length, line, tokenBox, arena, symbols ) ;
+    } // else
+
+} // BasicTokenProcessor::CutRange()
+
+template <class Policy>
+template <class Rules>
+void BasicTokenProcessor<Policy>::CutRangeWith( size_t start, size_t length, size_t line, std::vector<TokenRecord> & tokenBox,
+                                                TokenArena & arena, SymbolTable * symbols ) {
+
+    const char * source = SourceData() ;
+    size_t firstToken = tokenBox.size(), i = start ;
+
+    if ( mPending != PENDING_NONE ) {
+        i = ContinuePending( start, length, tokenBox, arena ) ;
+        firstToken = tokenBox.size() ; // a token begun on an earlier line keeps that line
+    } // if
+
+    for ( ; i < length ; i++ ) {
+
+        CharClass flags = CharClasses<Rules>().flags[( unsigned char ) source[i]] ;
+
+        if ( flags & CLASS_WHITE ) {
+            if ( Scans<Rules>( CLASS_WHITE ) ) {
+                size_t end = mScanner->skipWhite( source, i, length ) ;
+                if ( end > i ) {
+                    i = end - 1 ;
+                } // if
+            } // if
+        } // if
+        else if ( flags & CLASS_IDENTIFIER_START ) {
+            tokenBox.push_back( GetLetterToken<Rules>( i, source, length, symbols ) ) ;
+        } // else if
+        else if ( flags & CLASS_DIGIT ) {
+            tokenBox.push_back( GetNumberToken<Rules>( i, source, length, true ) ) ;
+        } // else if
+        else if ( ( unsigned char ) source[i] == Policy::kStringQuote || ( unsigned char ) source[i] == Policy::kCharQuote ) {
+            TokenType type = ( ( unsigned char ) source[i] == Policy::kStringQuote ? STRING : CHAR ) ;
+            tokenBox.push_back( GetStringToken( i, source, length, type, arena ) ) ;
+            if ( i >= length && Rules::kComments ) { // no right boundary
+                HoldString( line, tokenBox ) ;
+            } // if
+        } // else if
+        else if ( Rules::kComments && source[i] == '/' && i + 1 < length &&
+                  ( source[i + 1] == '/' || source[i + 1] == '*' ) ) {
+            mPending = ( source[i + 1] == '/' ? PENDING_LINE_COMMENT : PENDING_BLOCK_COMMENT ) ;
+            mPendingStart = i ;
+            mPendingLine = line ;
+            i = ContinuePending( i + 2, length, tokenBox, arena ) - 1 ;
+        } // else if
+        else if ( Rules::kComments && source[i] == '\\' && ContinuationAt( source, i, length ) == i ) {
+            break ; // the next line goes on with this one
+        } // else if
+        else { // CLASS_DELIMITER, or any other character
+            tokenBox.push_back( GetDelimiterToken<Rules>( i, source, length ) ) ;
+        } // else
+
+    } // for
+
+    for ( size_t i = firstToken ; i < tokenBox.size() ; i++ ) {
+        tokenBox[i].line = ( uint32_t ) line ;
+    } // for
+
+} // BasicTokenProcessor::CutRangeWith()
+
+// Where the '\\' that continues the line is, or "length" if the line does not go on.
+// Only [index, length) is looked at; a '\r' before the '\n' is allowed.
+template <class Policy>
+size_t BasicTokenProcessor<Policy>::ContinuationAt( const char * source, size_t index, size_t length ) {
+
+    size_t end = length ;
+
+    if ( end > index && source[end - 1] == '\r' ) {
+        end-- ;
+    } // if
+
+    return ( end > index && source[end - 1] == '\\' ? end - 1 : length ) ;
+
+} // BasicTokenProcessor::ContinuationAt()
+
+// Whether the contents of a literal from "index" to the line end "length" end with a '\\'
+// that escapes nothing but the line end.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::StringContinues( const char * source, size_t index, size_t length ) {
+
+    for ( ; index < length ; index++ ) {
+
+        if ( source[index] == '\\' ) {
+
+            if ( ContinuationAt( source, index, length ) == index ) {
+                return true ;
+            } // if
+
+            index++ ; // the escaped character
+
+        } // if
+
+    } // for
+
+    return false ;
+
+} // BasicTokenProcessor::StringContinues()
+
+// The last token is a literal without its right boundary; if its line goes on,
+// the literal waits for the next line instead.
+template <class Policy>
+void BasicTokenProcessor<Policy>::HoldString( size_t line, std::vector<TokenRecord> & tokenBox ) {
+
+    const TokenRecord & record = tokenBox.back() ;
+
+    if ( StringContinues( SourceData(), record.offset + 1, record.offset + record.length ) ) {
+        mPending = ( record.type == STRING ? PENDING_STRING : PENDING_CHAR ) ;
+        mPendingStart = record.offset ;
+        mPendingLine = line ;
+        tokenBox.pop_back() ;
+    } // if
+
+} // BasicTokenProcessor::HoldString()
+
+// Goes on with mPending from "index" up to the line end "length", and returns where
+// the ordinary tokens of the line start again ("length" if the whole line was used).
+template <class Policy>
+size_t BasicTokenProcessor<Policy>::ContinuePending( size_t index, size_t length, std::vector<TokenRecord> & tokenBox,
+                                                     TokenArena & arena ) {
+
+    const char * source = SourceData() ;
+
+    if ( mPending == PENDING_BLOCK_COMMENT ) {
+
+        while ( index + 1 < length ) {
+
+            const char * star = ( const char * ) memchr( source + index, '*', length - index - 1 ) ;
+
+            if ( star == NULL ) {
+                break ;
+            } // if
+
+            index = ( size_t ) ( star - source ) ;
+
+            if ( source[index + 1] == '/' ) {
+                EndPending( index + 2, index + 2, tokenBox, arena ) ;
+                return index + 2 ;
+            } // if
+
+            index++ ;
+
+        } // while
+
+    } // if
+    else if ( mPending == PENDING_LINE_COMMENT ) {
+
+        if ( ContinuationAt( source, index, length ) == length ) {
+            size_t end = ( length > index && source[length - 1] == '\r' ? length - 1 : length ) ;
+            EndPending( end, end, tokenBox, arena ) ;
+        } // if
+
+    } // else if
+    else { // PENDING_STRING or PENDING_CHAR
+
+        char boundaryChar = ( char ) ( mPending == PENDING_STRING ? Policy::kStringQuote : Policy::kCharQuote ) ;
+        size_t lineStart = index ;
+
+        index = mScanner->stringStop( source, index, length, boundaryChar ) ;
+
+        while ( index < length && source[index] == '\\' ) {
+
+            if ( index + 1 < length ) {
+                index++ ;
+            } // if
+
+            index = mScanner->stringStop( source, index + 1, length, boundaryChar ) ;
+
+        } // while
+
+        if ( index < length ) { // right boundary
+            EndPending( index + 1, index, tokenBox, arena ) ;
+            return index + 1 ;
+        } // if
+        else if ( !StringContinues( source, lineStart, length ) ) {
+            EndPending( length, length, tokenBox, arena ) ; // right boundary does not exist
+        } // else if
+        else {
+            ;
+        } // else
+
+    } // else
+
+    return length ;
+
+} // BasicTokenProcessor::ContinuePending()
+
+// Puts the token of mPending, source[mPendingStart, end), into the token box on the line it began.
+// "contentsEnd" is where the contents of a literal stop.
+template <class Policy>
+void BasicTokenProcessor<Policy>::EndPending( size_t end, size_t contentsEnd, std::vector<TokenRecord> & tokenBox,
+                                              TokenArena & arena ) {
+
+    int pending = mPending ;
+
+    mPending = PENDING_NONE ;
+
+    if ( ( pending == PENDING_BLOCK_COMMENT || pending == PENDING_LINE_COMMENT ) && CommentMode() == COMMENTS_SKIP ) {
+        return ;
+    } // if
+
+    const char * source = SourceData() ;
+    TokenRecord record( mPendingStart, end - mPendingStart, 0, 0.0, COMMENT ) ;
+
+    record.line = ( uint32_t ) mPendingLine ;
+
+    if ( pending == PENDING_STRING || pending == PENDING_CHAR ) {
+
+        size_t decodedLength = 0 ;
+        char * decoded = arena.Allocate( contentsEnd - mPendingStart ) ;
+
+        for ( size_t i = mPendingStart + 1 ; i < contentsEnd ; i++ ) { // continuations are dropped
+
+            if ( source[i] == '\\' && i + 1 < contentsEnd ) {
+                if ( source[i + 1] == '\n' ) {
+                    i++ ;
+                } // if
+                else if ( source[i + 1] == '\r' && i + 2 < contentsEnd && source[i + 2] == '\n' ) {
+                    i += 2 ;
+                } // else if
+                else {
+                    i++ ;
+                    decoded[decodedLength++] = ChangeChar( source[i] ) ;
+                } // else
+            } // if
+            else {
+                decoded[decodedLength++] = source[i] ;
+            } // else
+
+        } // for
+
+        record.type = ( pending == PENDING_STRING ? STRING : CHAR ) ;
+        record.contentsOffset = mPendingStart + 1 ;
+        record.contentsLength = decodedLength ;
+        record.decodedContents = decoded ;
+
+    } // if
+
+    tokenBox.push_back( record ) ;
+
+    for ( size_t i = mPendingLine + 1 ; i < mLines.size() ; i++ ) {
+        mLines[i].firstToken = tokenBox.size() ; // the lines it covers have no other token
+    } // for
+
+} // BasicTokenProcessor::EndPending()
+
+// Ends a comment or a literal still open after the last line, as the end of a file does.
+// Only needed after CutLine(); the other ways to cut end the input by themselves.
+template <class Policy>
+void BasicTokenProcessor<Policy>::EndInput() {
+
+    mInputEnded = true ;
+
+    if ( mPending == PENDING_NONE ) {
+        return ;
+    } // if
+
+    const char * source = SourceData() ;
+    size_t end = SourceLength() ;
+
+    while ( end > mPendingStart && ( source[end - 1] == '\n' || source[end - 1] == '\r' ) ) {
+        end-- ;
+    } // while
+
+    mColumnsValid = false ;
+
+# if TOKEN_PROCESSOR_STATS
+    size_t firstToken = mTokenBox.size() ;
+    EndPending( end, end, mTokenBox, *mArena ) ;
+    AddStats( firstToken, 0, 0 ) ;
+# else
+    EndPending( end, end, mTokenBox, *mArena ) ;
+# endif
+
+} // BasicTokenProcessor::EndInput()
+
+template <class Policy>
+template <class Rules>
+TokenRecord BasicTokenProcessor<Policy>::GetLetterToken( size_t & index, const char * source, size_t length, SymbolTable * symbols ) {
+
+    size_t start = index ;
+
+    index++ ;
+
+    if ( Scans<Rules>( CLASS_IDENTIFIER ) ) {
+        index = mScanner->identifierEnd( source, index, length ) ;
+    } // if
+
+    for ( ; index < length && ( CharClasses<Rules>().flags[( unsigned char ) source[index]] & CLASS_IDENTIFIER ) ; index++ ) {
+        ; // characters added to the default classes
+    } // for
+
+    size_t end = index ;
+
+    if ( index < length && ( !IsWhite<Rules>( source[index] ) ) ) {
+        index-- ;
+    } // if
+
+    TokenRecord record( start, end - start, 0, 0.0, IDENTIFIER ) ;
+
+    if ( symbols != NULL ) {
+        record.symbol = symbols->Intern( source + start, end - start ) ;
+    } // if
+
+    return record ;
+
+} // BasicTokenProcessor::GetLetterToken()
+
+template <class Policy>
+template <class Rules>
+TokenRecord BasicTokenProcessor<Policy>::GetNumberToken( size_t & index, const char * source, size_t length, bool beginWithInteger ) {
+
+    if ( Rules::kCNumbers ) {
+        return GetCNumberToken<Rules>( index, source, length ) ;
+    } // if
+
+    size_t start = index ;
+    bool isInt = beginWithInteger, running = true ;
+
+    index++ ;
+
+    while ( index < length && running ) {
+
+        if ( IsDigit<Rules>( source[index] ) ) {
+            size_t end = ( Scans<Rules>( CLASS_DIGIT ) ? mScanner->digitEnd( source, index, length ) : index ) ;
+            index = ( end > index ? end : index + 1 ) ;
+        } // if
+        else if ( Policy::kDoubles && source[index] == '.' ) {
+            if ( isInt ) {
+                isInt = false ;
+                index++ ;
+            } // if
+            else {
+                running = false ;
+            } // else
+        } // else if
+        else {
+            running = false ;
+        } // else
+
+    } // while
+
+    size_t end = index ;
+
+    if ( index < length && ( !IsWhite<Rules>( source[index] ) ) ) {
+        index-- ;
+    } // if
+
+    TokenRecord record( start, end - start, 0, 0.0, ( isInt ? INTEGER : DOUBLE ) ) ;
+
+    if ( mDeferNumbers ) {
+        record.numberFlags = NUMBER_DEFERRED ;
+    } // if
+    else {
+        record.numberFlags = ParseNumber( source + start, source + end, record.type, record.iValue, record.dValue ) ;
+    } // else
+
+    return record ;
+
+} // BasicTokenProcessor::GetNumberToken()
+
+// A C or C++ literal from source[index], a digit or a '.' before one. Like a preprocessing number,
+// it takes the letters and digits right after it, and a suffix that is not one is NUMBER_MALFORMED.
+template <class Policy>
+template <class Rules>
+TokenRecord BasicTokenProcessor<Policy>::GetCNumberToken( size_t & index, const char * source, size_t length ) {
+
+    size_t start = index, i = index ;
+    int base = 10 ;
+    bool isInt = true ;
+
+    if ( source[i] == '0' && i + 2 < length && ( source[i + 1] | 0x20 ) == 'x' &&
+         ( DigitValue( source[i + 2] ) < 16 || ( source[i + 2] == '.' && i + 3 < length && DigitValue( source[i + 3] ) < 16 ) ) ) {
+        base = 16 ;
+        i += 2 ;
+    } // if
+    else if ( source[i] == '0' && i + 2 < length && ( source[i + 1] | 0x20 ) == 'b' && DigitValue( source[i + 2] ) < 2 ) {
+        base = 2 ;
+        i += 2 ;
+    } // else if
+    else {
+        ;
+    } // else
+
+    i = ScanCDigits( source, i, length, base ) ; // octal literals are scanned as decimal, "09.5" is a DOUBLE
+
+    if ( i < length && source[i] == '.' && base != 2 ) {
+        isInt = false ;
+        i = ScanCDigits( source, i + 1, length, base ) ;
+    } // if
+
+    if ( base != 2 && i < length && ( source[i] | 0x20 ) == ( base == 16 ? 'p' : 'e' ) ) {
+
+        size_t digits = i + 1 ;
+
+        if ( digits < length && ( source[digits] == '+' || source[digits] == '-' ) ) {
+            digits++ ;
+        } // if
+
+        if ( digits < length && DigitValue( source[digits] ) < 10 ) {
+            isInt = false ;
+            i = ScanCDigits( source, digits, length, 10 ) ;
+        } // if
+
+    } // if
+
+    if ( i == start ) {
+        i++ ; // a character in CLASS_DIGIT that is not a digit
+    } // if
+
+    for ( ; i < length && ( CharClasses<Rules>().flags[( unsigned char ) source[i]] & CLASS_IDENTIFIER ) ; i++ ) {
+        ; // the suffix
+    } // for
+
+    size_t end = i ;
+
+    index = end ;
+    if ( index < length && ( !IsWhite<Rules>( source[index] ) ) ) {
+        index-- ;
+    } // if
+
+    TokenRecord record( start, end - start, 0, 0.0, ( isInt ? INTEGER : DOUBLE ) ) ;
+
+    if ( mDeferNumbers ) {
+        record.numberFlags = NUMBER_DEFERRED | NUMBER_C_GRAMMAR ;
+    } // if
+    else {
+        record.numberFlags = ParseCNumber( source + start, source + end, record.type, record.iValue, record.dValue ) ;
+    } // else
+
+    return record ;
+
+} // BasicTokenProcessor::GetCNumberToken()
+
+template <class Policy>
+TokenRecord BasicTokenProcessor<Policy>::GetStringToken( size_t & index, const char * source, size_t length, TokenType type,
+                                                         TokenArena & arena ) {
+
+    size_t start = index ; // left boundary
+    char boundaryChar = source[index] ;
+    bool hasEscape = false ;
+
+    index = mScanner->stringStop( source, index + 1, length, boundaryChar ) ;
+
+    while ( index < length && source[index] == '\\' ) {
+
+        if ( index + 1 < length ) {
+            hasEscape = true ;
+            index++ ;
+        } // if
+
+        index = mScanner->stringStop( source, index + 1, length, boundaryChar ) ;
+
+    } // while
+
+    TokenRecord record( start, 0, 0, 0.0, type ) ;
+
+    if ( index < length ) {
+        record.length = index - start + 1 ; // right boundary
+        record.contentsLength = record.length - 2 ;
+    } // if
+    else {
+        record.length = index - start ; // right boundary does not exist
+        record.contentsLength = record.length - 1 ;
+    } // else
+
+    record.contentsOffset = start + 1 ;
+
+    if ( hasEscape ) { // only contents with escapes need their own copy
+
+        size_t end = record.contentsOffset + record.contentsLength, decodedLength = 0 ;
+        char * decoded = arena.Allocate( record.contentsLength ) ; // never longer than the raw contents
+
+        for ( size_t i = start + 1 ; i < end ; i++ ) {
+
+            if ( source[i] == '\\' && i + 1 < length ) {
+                i++ ;
+                decoded[decodedLength++] = ChangeChar( source[i] ) ;
+            } // if
+            else {
+                decoded[decodedLength++] = source[i] ;
+            } // else
+
+        } // for
+
+        record.decodedContents = decoded ;
+        record.contentsLength = decodedLength ;
+
+    } // if
+
+    return record ;
+
+} // BasicTokenProcessor::GetStringToken()
+
+template <class Policy>
+template <class Rules>
+TokenRecord BasicTokenProcessor<Policy>::GetDelimiterToken( size_t & index, const char * source, size_t length ) {
+
+    size_t start = index, end = index ; // one character is a delimiter at least
+
+    if ( Policy::kLeadingDot && source[index] == '.' && index + 1 < length && IsDigit<Rules>( source[index + 1] ) ) {
+        return GetNumberToken<Rules>( index, source, length, false ) ; // number
+    } // if
+
+    const OperatorTable & operators = Operators<Rules>() ;
+    int state = 0 ;
+
+    for ( size_t i = index ; i < length ; i++ ) {
+
+        state = operators.next[state][operators.column[( unsigned char ) source[i]]] ;
+
+        if ( state == 0 ) {
+            break ;
+        } // if
+        else if ( operators.accept[state] ) {
+            end = i ; // the longest operator so far
+        } // else if
+        else {
+            ;
+        } // else
+
+    } // for
+
+    index = end ;
+
+    return TokenRecord( start, end - start + 1, 0, 0.0, DELIMITER ) ;
+
+} // BasicTokenProcessor::GetDelimiterToken()
+
+template <class Policy>
+const char * BasicTokenProcessor<Policy>::SourceData() {
+    return ( mMappedFile.Data() != NULL ? mMappedFile.Data() : mSource.data() ) ;
+} // BasicTokenProcessor::SourceData()
+
+template <class Policy>
+size_t BasicTokenProcessor<Policy>::SourceLength() {
+    return ( mMappedFile.Data() != NULL ? mMappedFile.Length() : mSource.length() ) ;
+} // BasicTokenProcessor::SourceLength()
+
+template <class Policy>
+void BasicTokenProcessor<Policy>::OwnSource() {
+
+    if ( mMappedFile.Data() != NULL ) { // more contents are coming, so the mapping is copied once
+
+        mSource.assign( mMappedFile.Data(), mMappedFile.Length() ) ;
+        mMappedFile.Unmap() ;
+
+        if ( mSource.length() != 0 && mSource[mSource.length() - 1] != '\n' ) {
+            mSource += '\n' ;
+        } // if
+
+    } // if
+
+} // BasicTokenProcessor::OwnSource()
+
+template <class Policy>
+size_t BasicTokenProcessor<Policy>::LineOffset( size_t line ) {
+    return mLines[line].offset + ( mLineShifts.empty() ? 0 : mLineShifts.At( line ).bytes ) ;
+} // BasicTokenProcessor::LineOffset()
+
+template <class Policy>
+size_t BasicTokenProcessor<Policy>::LineFirstToken( size_t line ) {
+    return mLines[line].firstToken + ( mLineShifts.empty() ? 0 : mLineShifts.At( line ).count ) ;
+} // BasicTokenProcessor::LineFirstToken()
+
+// Moves the lines from "line" on and their tokens as ReplaceLines() left them to be moved,
+// before they are read all together or written to.
+// A token has always moved as far as its line, so a column is right without moving either.
+template <class Policy>
+void BasicTokenProcessor<Policy>::ApplyShifts( size_t line ) {
+
+    size_t token = ( line < mLines.size() ? LineFirstToken( line ) : mTokenBox.size() ) ;
+
+    for ( size_t k = 0 ; k < mLineShifts.size() ; k++ ) {
+
+        const RecordShift & shift = mLineShifts[k] ;
+
+        for ( size_t i = ( shift.index > line ? shift.index : line ) ; i < mLineShifts.End( k ) ; i++ ) {
+            mLines[i].offset += shift.bytes ;
+            mLines[i].firstToken += shift.count ;
+        } // for
+
+    } // for
+
+    for ( size_t k = 0 ; k < mTokenShifts.size() ; k++ ) {
+
+        const RecordShift & shift = mTokenShifts[k] ;
+
+        for ( size_t i = ( shift.index > token ? shift.index : token ) ; i < mTokenShifts.End( k ) ; i++ ) {
+            mTokenBox[i].offset += shift.bytes ;
+            mTokenBox[i].contentsOffset += shift.bytes ;
+            mTokenBox[i].line += ( uint32_t ) shift.count ;
+        } // for
+
+    } // for
+
+    mLineShifts.Truncate( line ) ;
+    mTokenShifts.Truncate( token ) ;
+
+} // BasicTokenProcessor::ApplyShifts()
+
+template <class Policy>
+size_t BasicTokenProcessor<Policy>::GetLineCount() {
+    return mLines.size() ;
+} // BasicTokenProcessor::GetLineCount()
+
+// "line" counts the lines held, from 0; without its '\n'.
+template <class Policy>
+std::string_view BasicTokenProcessor<Policy>::GetLine( size_t line ) {
+
+    const char * source = SourceData() ;
+    size_t start = LineOffset( line ), end = 0 ;
+
+    if ( line + 1 < mLines.size() ) {
+        end = LineOffset( line + 1 ) - 1 ; // no '\n'
+    } // if
+    else {
+        end = SourceLength() ;
+        if ( end > start && source[end - 1] == '\n' ) {
+            end-- ; // a mapped file may not end with '\n'
+        } // if
+    } // else
+
+    return std::string_view( source + start, end - start ) ;
+
+} // BasicTokenProcessor::GetLine()
+
+// Line and column of any byte offset of the input, by a binary search of the line starts.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::GetPosition( size_t offset, size_t & line, size_t & column ) {
+
+    if ( offset < mSourceBase || mLines.empty() || offset - mSourceBase < LineOffset( 0 ) ) {
+        return false ; // a stream has dropped its line
+    } // if
+
+    offset -= mSourceBase ;
+
+    size_t low = 0, high = mLines.size() ; // the last line starting at or before offset
+
+    while ( high - low > 1 ) {
+
+        size_t middle = ( low + high ) / 2 ;
+
+        if ( LineOffset( middle ) <= offset ) {
+            low = middle ;
+        } // if
+        else {
+            high = middle ;
+        } // else
+
+    } // while
+
+    line = low + mLineBase ;
+    column = offset - LineOffset( low ) ;
+    return true ;
+
+} // BasicTokenProcessor::GetPosition()
+
+template <class Policy>
+TokenView BasicTokenProcessor<Policy>::MakeTokenView( const TokenRecord & record ) {
+
+    TokenView view ;
+
+    view.token = std::string_view( SourceData() + record.offset, record.length ) ;
+    view.numberFlags = GetNumber( record, view.iValue, view.dValue ) ;
+    view.type = record.type ;
+    view.offset = record.offset + mSourceBase ;
+    view.line = record.line + mLineBase ;
+    view.column = record.offset - mLines[record.line].offset ;
+    view.symbol = record.symbol ;
+
+    if ( record.decodedContents != NULL ) {
+        view.contents = std::string_view( record.decodedContents, record.contentsLength ) ;
+    } // if
+    else if ( record.contentsLength != 0 ) {
+        view.contents = std::string_view( SourceData() + record.contentsOffset, record.contentsLength ) ;
+    } // else if
+    else {
+        ;
+    } // else
+
+    return view ;
+
+} // BasicTokenProcessor::MakeTokenView()
+
+// The view of token "index" where it has moved to, without writing to the records.
+template <class Policy>
+TokenView BasicTokenProcessor<Policy>::MakeTokenView( size_t index ) {
+
+    TokenRecord record = mTokenBox[index] ;
+    size_t bytes = 0 ;
+
+    if ( !mTokenShifts.empty() ) {
+        RecordShift shift = mTokenShifts.At( index ) ;
+        bytes = shift.bytes ;
+        record.offset += shift.bytes ;
+        record.contentsOffset += shift.bytes ;
+        record.line += ( uint32_t ) shift.count ;
+    } // if
+
+    TokenView view = MakeTokenView( record ) ;
+
+    view.column -= bytes ; // its line has moved as far, see ApplyShifts()
+    return view ;
+
+} // BasicTokenProcessor::MakeTokenView()
+
+// The value of a token as a view shows it, converting a deferred number without keeping the
+// result, so that readers on several threads never write to the token box. Returns the flags.
+template <class Policy>
+int BasicTokenProcessor<Policy>::GetNumber( const TokenRecord & record, int64_t & iValue, double & dValue ) {
+
+    iValue = 0 ;
+    dValue = 0.0 ;
+
+    if ( record.numberFlags & NUMBER_DEFERRED ) {
+        const char * text = SourceData() + record.offset ;
+        return ( record.numberFlags & NUMBER_C_GRAMMAR ?
+                 ParseCNumber( text, text + record.length, record.type, iValue, dValue ) :
+                 ParseNumber( text, text + record.length, record.type, iValue, dValue ) ) ;
+    } // if
+    else if ( record.type == DOUBLE ) {
+        dValue = record.dValue ;
+    } // else if
+    else {
+        iValue = record.iValue ;
+    } // else
+
+    return ( int ) record.numberFlags ;
+
+} // BasicTokenProcessor::GetNumber()
+
+// The columns stay valid until the token box changes.
+template <class Policy>
+const TokenColumns & BasicTokenProcessor<Policy>::GetColumns() {
+
+    if ( !mColumnsValid ) {
+        BuildColumns() ;
+        mColumnsValid = true ;
+    } // if
+
+    return mColumns ;
+
+} // BasicTokenProcessor::GetColumns()
+
+template <class Policy>
+void BasicTokenProcessor<Policy>::BuildColumns() {
+
+    ApplyShifts() ;
+
+    static_assert( ( NUMBER_OVERFLOW | NUMBER_UNDERFLOW | NUMBER_MALFORMED | NUMBER_UNSIGNED | NUMBER_LONG |
+                     NUMBER_LONG_LONG | NUMBER_FLOAT ) <= UINT8_MAX, "the flags of a view fit numberFlags" ) ;
+
+    size_t size = mTokenBox.size() ;
+
+    mColumns.types.resize( size ) ;
+    mColumns.offsets.resize( size ) ;
+    mColumns.lengths.resize( size ) ;
+    mColumns.lines.resize( size ) ;
+    mColumns.iValues.resize( size ) ;
+    mColumns.dValues.resize( size ) ;
+    mColumns.numberFlags.resize( size ) ;
+    mColumns.contentsIndexes.resize( size ) ;
+    mColumns.contents.clear() ;
+    mColumns.symbols.resize( size ) ;
+    mColumns.source = std::string_view( SourceData(), SourceLength() ) ;
+
+    for ( size_t i = 0 ; i < size ; i++ ) {
+
+        const TokenRecord & record = mTokenBox[i] ;
+
+        mColumns.types[i] = ( uint8_t ) record.type ;
+        mColumns.offsets[i] = record.offset ;
+        mColumns.lengths[i] = record.length ;
+        mColumns.lines[i] = record.line ;
+        mColumns.numberFlags[i] = ( uint8_t ) GetNumber( record, mColumns.iValues[i], mColumns.dValues[i] ) ;
+        mColumns.symbols[i] = record.symbol ;
+
+        if ( record.type == STRING || record.type == CHAR ) {
+            mColumns.contentsIndexes[i] = mColumns.contents.size() ;
+            mColumns.contents.push_back( MakeTokenView( record ).contents ) ;
+        } // if
+        else {
+            mColumns.contentsIndexes[i] = NO_CONTENTS ;
+        } // else
+
+    } // for
+
+} // BasicTokenProcessor::BuildColumns()
+
+template <class Policy>
+void BasicTokenProcessor<Policy>::CopyToken( const TokenView & view, TokenData & token ) {
+
+    token.token.assign( view.token ) ; // reuses the capacity token already has
+    token.iValue = view.iValue ;
+    token.dValue = view.dValue ;
+    token.contents.assign( view.contents ) ;
+    token.type = view.type ;
+    token.offset = view.offset ;
+    token.line = view.line ;
+    token.column = view.column ;
+    token.symbol = view.symbol ;
+    token.numberFlags = view.numberFlags ;
+
+} // BasicTokenProcessor::CopyToken()
+
+template <class Policy>
+bool BasicTokenProcessor<Policy>::GetToken( TokenData & token ) {
+
+    TokenView view ;
+
+    if ( GetToken( view ) ) {
+        CopyToken( view, token ) ;
+        return true ;
+    } // if
+    else {
+        token = TokenData() ;
+        return false ;
+    } // else
+
+} // BasicTokenProcessor::GetToken()
+
+template <class Policy>
+bool BasicTokenProcessor<Policy>::GetToken( TokenData & token, int times ) {
+
+    if ( times <= 0 ) {
+        return false ;
+    } // if
+
+    if ( Skip( ( size_t ) times - 1 ) < ( size_t ) times - 1 ) { // skip without copying
+        token = TokenData() ;
+        return false ;
+    } // if
+
+    return GetToken( token ) ;
+
+} // BasicTokenProcessor::GetToken()
+
+template <class Policy>
+bool BasicTokenProcessor<Policy>::PeekToken( TokenData & token ) {
+
+    TokenView view ;
+
+    if ( PeekToken( view ) ) {
+        CopyToken( view, token ) ;
+        return true ;
+    } // if
+    else {
+        token = TokenData() ;
+        return false ;
+    } // else
+
+} // BasicTokenProcessor::PeekToken()
+
+template <class Policy>
+bool BasicTokenProcessor<Policy>::GetToken( TokenView & token ) {
+
+    if ( mTokenIndex >= mTokenBox.size() ) {
+        PullStream() ;
+    } // if
+
+    if ( mTokenIndex < mTokenBox.size() ) {
+        token = MakeTokenView( mTokenIndex++ ) ;
+        return true ;
+    } // if
+    else {
+        token = TokenView() ;
+        return false ;
+    } // else
+
+} // BasicTokenProcessor::GetToken()
+
+template <class Policy>
+bool BasicTokenProcessor<Policy>::GetToken( TokenView & token, int times ) {
+
+    if ( times <= 0 ) {
+        return false ;
+    } // if
+
+    if ( Skip( ( size_t ) times - 1 ) < ( size_t ) times - 1 ) {
+        token = TokenView() ;
+        return false ;
+    } // if
+
+    return GetToken( token ) ;
+
+} // BasicTokenProcessor::GetToken()
+
+template <class Policy>
+bool BasicTokenProcessor<Policy>::PeekToken( TokenView & token ) {
+    return PeekToken( token, 0 ) ;
+} // BasicTokenProcessor::PeekToken()
+
+// The token after the next "ahead" ones, without consuming anything.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::PeekToken( TokenView & token, size_t ahead ) {
+
+    if ( mTokenBox.size() - mTokenIndex <= ahead ) {
+        PullStream( ahead ) ;
+    } // if
+
+    if ( mTokenBox.size() - mTokenIndex > ahead ) {
+        token = MakeTokenView( mTokenIndex + ahead ) ;
+        return true ;
+    } // if
+    else {
+        token = TokenView() ;
+        return false ;
+    } // else
+
+} // BasicTokenProcessor::PeekToken()
+
+// Consumes up to "count" tokens into "tokens" and returns how many; 0 when no token is left.
+// A stream gives only the tokens held at once, so that every view stays valid.
+template <class Policy>
+size_t BasicTokenProcessor<Policy>::GetTokens( TokenView * tokens, size_t count ) {
+
+    if ( mTokenIndex >= mTokenBox.size() ) {
+        PullStream() ;
+    } // if
+
+    size_t held = mTokenBox.size() - mTokenIndex ;
+
+    if ( count > held ) {
+        count = held ;
+    } // if
+
+    for ( size_t i = 0 ; i < count ; i++ ) {
+        tokens[i] = MakeTokenView( mTokenIndex + i ) ;
+    } // for
+
+    mTokenIndex += count ;
+    return count ;
+
+} // BasicTokenProcessor::GetTokens()
+
+// Consumes up to "count" tokens without looking at them, and returns how many.
+template <class Policy>
+size_t BasicTokenProcessor<Policy>::Skip( size_t count ) {
+
+    size_t skipped = 0 ;
+
+    while ( skipped < count && ( mTokenIndex < mTokenBox.size() || PullStream() ) ) {
+
+        size_t step = mTokenBox.size() - mTokenIndex ;
+
+        if ( step > count - skipped ) {
+            step = count - skipped ;
+        } // if
+
+        mTokenIndex += step ;
+        skipped += step ;
+
+    } // while
+
+    return skipped ;
+
+} // BasicTokenProcessor::Skip()
+
+// The position of the next token, to come back to by Reset(). Marks nest freely and stay
+// valid until the token box is cut again or edited. A stream keeps every token after
+// a mark until Release(); otherwise Release() is not needed.
+template <class Policy>
+TokenMark BasicTokenProcessor<Policy>::Mark() {
+
+    TokenMark mark ;
+
+    mark.index = mTokenBase + mTokenIndex ;
+    mMarks++ ;
+    return mark ;
+
+} // BasicTokenProcessor::Mark()
+
+// Whether the mark is of a token held, or of the end of them: not of one a stream has dropped
+// nor past the tokens cut so far.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::HoldsMark( TokenMark mark ) {
+    return mark.index >= mTokenBase && mark.index - mTokenBase <= mTokenBox.size() ;
+} // BasicTokenProcessor::HoldsMark()
+
+// Returns false, and stays where it is, if a stream has already dropped the marked token
+// or the mark is past the tokens held.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::Reset( TokenMark mark ) {
+
+    if ( !HoldsMark( mark ) ) {
+        return false ;
+    } // if
+
+    mTokenIndex = mark.index - mTokenBase ;
+    return true ;
+
+} // BasicTokenProcessor::Reset()
+
+// A mark Reset() would refuse is not counted as released, so a stream keeps the tokens of the others.
+template <class Policy>
+void BasicTokenProcessor<Policy>::Release( TokenMark mark ) {
+
+    if ( mMarks > 0 && HoldsMark( mark ) ) {
+        mMarks-- ;
+    } // if
+
+} // BasicTokenProcessor::Release()
+
+// A cursor at the next token; it moves on its own from then on.
+template <class Policy>
+BasicTokenCursor<Policy> BasicTokenProcessor<Policy>::GetCursor() {
+    return BasicTokenCursor<Policy>( *this, mTokenIndex ) ;
+} // BasicTokenProcessor::GetCursor()
+
+template <class Policy>
+void BasicTokenProcessor<Policy>::Output( bool setBracket, bool setBoundary ) {
+    StreamSink sink( std::cout ) ;
+    Output( sink, setBracket, setBoundary ) ;
+} // BasicTokenProcessor::Output()
+
+template <class Policy>
+void BasicTokenProcessor<Policy>::OutputOriginal( bool setBoundary ) {
+    StreamSink sink( std::cout ) ;
+    OutputOriginal( sink, setBoundary ) ;
+} // BasicTokenProcessor::OutputOriginal()
+
+// Same text as Output() to std::cout, written a buffer at a time; false if the sink failed.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::Output( TokenSink & sink, bool setBracket, bool setBoundary ) {
+
+    mOutputBuffer.Begin( sink ) ;
+
+    if ( setBoundary ) {
+        mOutputBuffer.Append( "---------- Tokens ----------\n" ) ;
+    } // if
+
+    ApplyShifts() ;
+
+    const char * source = SourceData() ;
+
+    for ( size_t i = 0 ; i < mLines.size() ; i++ ) {
+
+        size_t end = ( i + 1 < mLines.size() ? mLines[i + 1].firstToken : mTokenBox.size() ) ;
+
+        if ( mLines[i].firstToken == end ) {
+            continue ; // a line without tokens is not a row
+        } // if
+
+        for ( size_t j = mLines[i].firstToken ; j < end ; j++ ) {
+
+            if ( setBracket ) {
+                mOutputBuffer.Append( '[' ) ;
+                mOutputBuffer.Append( source + mTokenBox[j].offset, mTokenBox[j].length ) ;
+                mOutputBuffer.Append( "]  " ) ;
+            } // if
+            else {
+                mOutputBuffer.Append( source + mTokenBox[j].offset, mTokenBox[j].length ) ;
+                mOutputBuffer.Append( "  " ) ;
+            } // else
+
+        } // for
+
+        mOutputBuffer.Append( '\n' ) ;
+
+    } // for
+
+    if ( setBoundary ) {
+        mOutputBuffer.Append( "----------------------------\n" ) ;
+    } // if
+
+    return mOutputBuffer.End() ;
+
+} // BasicTokenProcessor::Output()
+
+template <class Policy>
+bool BasicTokenProcessor<Policy>::OutputOriginal( TokenSink & sink, bool setBoundary ) {
+
+    mOutputBuffer.Begin( sink ) ;
+
+    if ( setBoundary ) {
+        mOutputBuffer.Append( "---------- Original ----------\n" ) ;
+    } // if
+
+    for ( size_t i = 0 ; i < mLines.size() ; i++ ) {
+        mOutputBuffer.Append( GetLine( i ) ) ;
+        mOutputBuffer.Append( '\n' ) ;
+    } // for
+
+    if ( setBoundary ) {
+        mOutputBuffer.Append( "------------------------------\n" ) ;
+    } // if
+
+    return mOutputBuffer.End() ;
+
+} // BasicTokenProcessor::OutputOriginal()
+
+template <class Policy>
+void BasicTokenProcessor<Policy>::Clear() {
+
+    mSource.clear() ;
+    mMappedFile.Unmap() ;
+    mCacheFile.Unmap() ;
+    mCacheData.clear() ;
+    mLines.clear() ;
+    if ( mArena == &mOwnArena ) {
+        mArena->Reset() ;
+    } // if
+    mTokenBox.clear() ;
+    mLineShifts.clear() ;
+    mTokenShifts.clear() ;
+    mTokenIndex = 0 ;
+    mTokenBase = mMarks = 0 ;
+    mColumnsValid = false ;
+
+    mStream = NULL ;
+    mStreamLexed = 0 ;
+    mSourceBase = mLineBase = 0 ;
+
+    mPending = PENDING_NONE ;
+    mInputEnded = false ;
+
+} // BasicTokenProcessor::Clear()
+
+template <class Policy>
+void BasicTokenProcessor<Policy>::BackToBeginning() {
+    mTokenIndex = 0 ;
+} //  BasicTokenProcessor::BackToBeginning()
+
+template <class Policy>
+char BasicTokenProcessor<Policy>::ChangeChar( char ch ) {
+    return Policy::kEscapes.to[( unsigned char ) ch] ;
+} // BasicTokenProcessor::ChangeChar()
+
+template <class Policy>
+void BasicTokenProcessor<Policy>::SetCharClass( char ch, CharClass flags ) {
+    mCharClasses.flags[( unsigned char ) ch] = flags ;
+    mPolicyTables = false ;
+    UpdateScanners() ;
+} // BasicTokenProcessor::SetCharClass()
+
+template <class Policy>
+CharClass BasicTokenProcessor<Policy>::GetCharClass( char ch ) {
+    return mCharClasses.flags[( unsigned char ) ch] ;
+} // BasicTokenProcessor::GetCharClass()
+
+// Returns false if the table is full.
+template <class Policy>
+bool BasicTokenProcessor<Policy>::AddOperator( const std::string & op ) {
+    mPolicyTables = false ;
+    return InsertOperator( mOperators, op.data(), op.length() ) ;
+} // BasicTokenProcessor::AddOperator()
+
+// Decoded contents go to "arena" from now on; NULL goes back to the processor's own arena.
+// Clear() resets only the processor's own arena, a shared one is reset by its owner.
+template <class Policy>
+void BasicTokenProcessor<Policy>::SetArena( TokenArena * arena ) {
+    mArena = ( arena != NULL ? arena : &mOwnArena ) ;
+} // BasicTokenProcessor::SetArena()
+
+// While interning, every IDENTIFIER gets the id of its name in the symbol table as "symbol";
+// tokens the processor holds already get theirs now. The table is kept by Clear().
+template <class Policy>
+void BasicTokenProcessor<Policy>::SetInterning( bool interning ) {
+
+    mInterning = interning ;
+
+    if ( mInterning ) {
+        InternSymbols( 0 ) ;
+    } // if
+
+} // BasicTokenProcessor::SetInterning()
+
+// A deferred INTEGER or DOUBLE is only scanned while cutting, and converted each time a token
+// is read. Tokens already cut keep their values.
+template <class Policy>
+void BasicTokenProcessor<Policy>::SetDeferNumbers( bool defer ) {
+    mDeferNumbers = defer ;
+} // BasicTokenProcessor::SetDeferNumbers()
+
+// NUMBERS_PLAIN (the default) or NUMBERS_C, for the numbers cut from now on.
+// A policy whose kNumberMode is not MODE_RUNTIME keeps its own mode.
+template <class Policy>
+void BasicTokenProcessor<Policy>::SetNumberMode( int mode ) {
+    mNumberMode = mode ;
+} // BasicTokenProcessor::SetNumberMode()
+
+// Identifiers are interned in "symbols" from now on; NULL goes back to the processor's own table.
+// Processors that share a table give the same name the same id, but must not cut at the same time.
+template <class Policy>
+void BasicTokenProcessor<Policy>::SetSymbolTable( SymbolTable * symbols ) {
+
+    mSymbols = ( symbols != NULL ? symbols : &mOwnSymbols ) ;
+
+    if ( mInterning ) {
+        InternSymbols( 0 ) ;
+    } // if
+
+} // BasicTokenProcessor::SetSymbolTable()
+
+// For keywords before cutting, and for the names of ids after.
+template <class Policy>
+SymbolTable & BasicTokenProcessor<Policy>::GetSymbolTable() {
+    return *mSymbols ;
+} // BasicTokenProcessor::GetSymbolTable()
+
+// Interns every IDENTIFIER from token "first" on.
+template <class Policy>
+void BasicTokenProcessor<Policy>::InternSymbols( size_t first ) {
+
+    const char * source = SourceData() ;
+
+    ApplyShifts() ;
+
+    for ( size_t i = first ; i < mTokenBox.size() ; i++ ) {
+        if ( mTokenBox[i].type == IDENTIFIER ) {
+            mTokenBox[i].symbol = mSymbols->Intern( source + mTokenBox[i].offset, mTokenBox[i].length ) ;
+        } // if
+    } // for
+
+    mColumnsValid = false ;
+
+} // BasicTokenProcessor::InternSymbols()
+
+// 0 uses every hardware thread; sources under TOKEN_PROCESSOR_PARALLEL_MIN_BYTES stay on one thread.
+template <class Policy>
+void BasicTokenProcessor<Policy>::SetThreadCount( unsigned threadCount ) {
+
+    if ( threadCount == 0 ) {
+        threadCount = std::thread::hardware_concurrency() ;
+    } // if
+
+    mThreadCount = ( threadCount != 0 ? threadCount : 1 ) ;
+
+} // BasicTokenProcessor::SetThreadCount()
+
+// SCAN_SCALAR, SCAN_SSE2 or SCAN_AVX2; the CPU may not run the level asked for.
+template <class Policy>
+void BasicTokenProcessor<Policy>::SetScanLevel( int level ) {
+    mScanner = SelectScanKernels( level ) ;
+} // BasicTokenProcessor::SetScanLevel()
+
+template <class Policy>
+int BasicTokenProcessor<Policy>::GetScanLevel() {
+    return mScanner->level ;
+} // BasicTokenProcessor::GetScanLevel()
+
+// COMMENTS_OFF, COMMENTS_SKIP or COMMENTS_KEEP. Outside COMMENTS_OFF a '\\' at the end of a line
+// joins it to the next one, and comments, strings and chars may go on over several lines.
+// A policy whose kCommentMode is not MODE_RUNTIME keeps its own mode.
+template <class Policy>
+void BasicTokenProcessor<Policy>::SetCommentMode( int mode ) {
+    mCommentMode = mode ;
+} // BasicTokenProcessor::SetCommentMode()
+
+template <class Policy>
+TokenStats BasicTokenProcessor<Policy>::GetStats() {
+# if TOKEN_PROCESSOR_STATS
+    return mStats ;
+# else
+    return TokenStats() ;
+# endif
+} // BasicTokenProcessor::GetStats()
+
+template <class Policy>
+void BasicTokenProcessor<Policy>::ResetStats() {
+
+# if TOKEN_PROCESSOR_STATS
+    mStats = TokenStats() ;
+    mStatsNext = mStatsInterval ;
+    mSeenCapacities[0] = mSource.capacity() ;
+    mSeenCapacities[1] = mLines.capacity() ;
+    mSeenCapacities[2] = mTokenBox.capacity() ;
+    mSeenBlocks = mArena->GetBlockCount() ;
+# endif
+
+} // BasicTokenProcessor::ResetStats()
+
+// "callback" is called with GetStats() after every "interval" bytes cut; NULL stops it.
+// Does nothing unless TOKEN_PROCESSOR_STATS is 1.
+template <class Policy>
+void BasicTokenProcessor<Policy>::SetStatsCallback( TokenStatsCallback callback, void * context, size_t interval ) {
+
+# if TOKEN_PROCESSOR_STATS
+    mStatsCallback = callback ;
+    mStatsContext = context ;
+    mStatsInterval = ( interval != 0 ? interval : 1 ) ;
+    mStatsNext = mStats.bytes + mStatsInterval ;
+# else
+    ( void ) callback ;
+    ( void ) context ;
+    ( void ) interval ;
+# endif
+
+} // BasicTokenProcessor::SetStatsCallback()
+
+# if TOKEN_PROCESSOR_STATS
+// Counts the tokens from "firstToken" to the end of the token box, cut from "bytes" bytes in "lines" lines.
+template <class Policy>
+void BasicTokenProcessor<Policy>::AddStats( size_t firstToken, size_t bytes, size_t lines ) {
+
+    for ( size_t i = firstToken ; i < mTokenBox.size() ; i++ ) {
+
+        const TokenRecord & record = mTokenBox[i] ;
+
+        mStats.typeCounts[record.type <= COMMENT ? record.type : UNKNOWN]++ ;
+
+        if ( record.length > mStats.longestToken ) {
+            mStats.longestToken = record.length ;
+            mStats.longestTokenLine = mLineBase + record.line ;
+        } // if
+
+    } // for
+
+    mStats.tokens += mTokenBox.size() - firstToken ;
+    mStats.bytes += bytes ;
+    mStats.lines += lines ;
+
+    size_t capacities[3] = { mSource.capacity(), mLines.capacity(), mTokenBox.capacity() } ;
+
+    for ( size_t i = 0 ; i < 3 ; i++ ) {
+        if ( capacities[i] != mSeenCapacities[i] ) {
+            mStats.allocations++ ;
+            mSeenCapacities[i] = capacities[i] ;
+        } // if
+    } // for
+
+    if ( mArena->GetBlockCount() > mSeenBlocks ) {
+        mStats.allocations += mArena->GetBlockCount() - mSeenBlocks ;
+    } // if
+
+    mSeenBlocks = mArena->GetBlockCount() ;
+
+    if ( mStatsCallback != NULL && mStats.bytes >= mStatsNext ) {
+        mStatsNext = mStats.bytes + mStatsInterval ;
+        mStatsCallback( mStats, mStatsContext ) ;
+    } // if
+
+} // BasicTokenProcessor::AddStats()
+# endif
+
+template <class Policy>
+void BasicTokenProcessor<Policy>::UpdateScanners() {
+    mScanClasses = ScanClasses( mCharClasses ) ;
+} // BasicTokenProcessor::UpdateScanners()
+
+template <class Policy>
+template <class Rules>
+const CharClassTable & BasicTokenProcessor<Policy>::CharClasses() {
+
+    if constexpr ( Rules::kPolicyTables ) {
+        return Policy::kCharClasses ;
+    } // if
+    else {
+        return mCharClasses ;
+    } // else
+
+} // BasicTokenProcessor::CharClasses()
+
+template <class Policy>
+template <class Rules>
+const OperatorTable & BasicTokenProcessor<Policy>::Operators() {
+
+    if constexpr ( Rules::kPolicyTables ) {
+        return Policy::kOperators ;
+    } // if
+    else {
+        return mOperators ;
+    } // else
+
+} // BasicTokenProcessor::Operators()
+
+// Whether the scan kernels can be used for "flag", one of CLASS_WHITE, CLASS_IDENTIFIER and CLASS_DIGIT.
+template <class Policy>
+template <class Rules>
+bool BasicTokenProcessor<Policy>::Scans( CharClass flag ) {
+
+    if constexpr ( Rules::kPolicyTables ) {
+        return ( kPolicyScanClasses & flag ) != 0 ;
+    } // if
+    else {
+        return ( mScanClasses & flag ) != 0 ;
+    } // else
+
+} // BasicTokenProcessor::Scans()
+
+template <class Policy>
+template <class Rules>
+bool BasicTokenProcessor<Policy>::IsWhite( char ch ) {
+    return ( CharClasses<Rules>().flags[( unsigned char ) ch] & CLASS_WHITE ) != 0 ;
+} // BasicTokenProcessor::IsWhite()
+
+template <class Policy>
+template <class Rules>
+bool BasicTokenProcessor<Policy>::IsDigit( char ch ) {
+    return ( CharClasses<Rules>().flags[( unsigned char ) ch] & CLASS_DIGIT ) != 0 ;
+} // BasicTokenProcessor::IsDigit()
+
+template <class Policy>
+int BasicTokenProcessor<Policy>::CommentMode() {
+
+    if constexpr ( Policy::kCommentMode != MODE_RUNTIME ) {
+        return Policy::kCommentMode ;
+    } // if
+    else {
+        return mCommentMode ;
+    } // else
+
+} // BasicTokenProcessor::CommentMode()
+
+template <class Policy>
+int BasicTokenProcessor<Policy>::NumberMode() {
+
+    if constexpr ( Policy::kNumberMode != MODE_RUNTIME ) {
+        return Policy::kNumberMode ;
+    } // if
+    else {
+        return mNumberMode ;
+    } // else
+
+} // BasicTokenProcessor::NumberMode()
+
+template <class Policy>
+bool BasicTokenCursor<Policy>::GetToken( TokenView & token ) {
+
+    if ( PeekToken( token, 0 ) ) {
+        mIndex++ ;
+        return true ;
+    } // if
+    else {
+        return false ;
+    } // else
+
+} // BasicTokenCursor::GetToken()
+
+template <class Policy>
+bool BasicTokenCursor<Policy>::PeekToken( TokenView & token, size_t ahead ) {
+
+    const std::vector<TokenRecord> & tokenBox = mProcessor->mTokenBox ;
+
+    if ( mIndex < tokenBox.size() && tokenBox.size() - mIndex > ahead ) {
+        token = mProcessor->MakeTokenView( mIndex + ahead ) ;
+        return true ;
+    } // if
+    else {
+        token = TokenView() ;
+        return false ;
+    } // else
+
+} // BasicTokenCursor::PeekToken()
+
+template <class Policy>
+size_t BasicTokenCursor<Policy>::GetTokens( TokenView * tokens, size_t count ) {
+
+    size_t got = 0 ;
+
+    while ( got < count && GetToken( tokens[got] ) ) {
+        got++ ;
+    } // while
+
+    return got ;
+
+} // BasicTokenCursor::GetTokens()
+
+template <class Policy>
+size_t BasicTokenCursor<Policy>::Skip( size_t count ) {
+
+    size_t size = mProcessor->mTokenBox.size() ;
+    size_t skipped = ( mIndex < size ? size - mIndex : 0 ) ;
+
+    if ( skipped > count ) {
+        skipped = count ;
+    } // if
+
+    mIndex += skipped ;
+    return skipped ;
+
+} // BasicTokenCursor::Skip()
+
+template <class Policy>
+TokenMark BasicTokenCursor<Policy>::Mark() {
+
+    TokenMark mark ;
+
+    mark.index = mProcessor->mTokenBase + mIndex ;
+    return mark ;
+
+} // BasicTokenCursor::Mark()
+
+// Marks of the processor and of its cursors are the same positions, and are refused the same way.
+template <class Policy>
+bool BasicTokenCursor<Policy>::Reset( TokenMark mark ) {
+
+    if ( !mProcessor->HoldsMark( mark ) ) {
+        return false ;
+    } // if
+
+    mIndex = mark.index - mProcessor->mTokenBase ;
+    return true ;
+
+} // BasicTokenCursor::Reset()
+
+# endif // TOKEN_PROCESSOR_H_INCLUDED
@@ -1,23 +1,396 @@
 ﻿# include "TokenProcessor.h"
 
-int main() {
+# include <mutex>
+# include <condition_variable>
 
-    TokenProcessor * tp = new TokenProcessor() ;
+/*
+ * TokenProcessor_v3 [options] [file ...]
+ *
+ * Cuts each file, or stdin when there is no file or the file is "-", and writes the tokens to stdout
+ * in the order of the files.
+ *
+ *   --format=text     bracketed tokens, as Output() writes them (the default)
+ *   --format=tsv      file, line, column, type and token, tab separated; lines and columns from 1
+ *   --format=jsonl    one JSON object per token, with the value of a number and the contents of a literal
+ *   --format=binary   per file: the path length (4 bytes) and the path, the stream length (8 bytes)
+ *                     and the stream SaveTokens() writes; little endian, the same on every machine
+ *   --jobs N          cut N files at once; one file is cut by N threads instead (0 is one per core)
+ *   --comments=MODE   off, skip or keep
+ *   --numbers=MODE    plain or c
+ *   --stats           bytes/s and tokens/s to stderr
+ */
 
-    std::fstream inFile( "../../test_input/test01.txt", std::ios::in ) ;
+# define FORMAT_TEXT 0
+# define FORMAT_TSV 1
+# define FORMAT_JSONL 2
+# define FORMAT_BINARY 3
 
-    if ( inFile ) {
-        tp->CutFile( inFile ) ;
-        tp->Output() ;
-        inFile.close() ;
+struct CliOptions {
+    int format ;
+    unsigned jobs ;
+    int commentMode ;
+    int numberMode ;
+    bool stats ;
+    bool header ; // "==> path <==" before each file of the text format
+    CliOptions() : format( FORMAT_TEXT ), jobs( 1 ), commentMode( COMMENTS_OFF ), numberMode( NUMBERS_PLAIN ),
+                   stats( false ), header( false ) {} // constructor
+} ; // struct CliOptions
+
+struct FileResult {
+    std::string output ;
+    size_t bytes ;
+    size_t tokens ;
+    bool done ;
+    bool successOrNot ;
+    const char * error ; // why it failed, for stderr
+    FileResult() : bytes( 0 ), tokens( 0 ), done( false ), successOrNot( false ), error( "can not read" ) {} // constructor
+} ; // struct FileResult
+
+static const char * const kTypeNames[] = {
+    "UNKNOWN", "IDENTIFIER", "INTEGER", "DOUBLE", "DELIMITER", "STRING", "CHAR", "COMMENT"
+} ;
+
+// By FORMAT_*, COMMENTS_* and NUMBERS_*.
+static const char * const kFormatNames[] = { "text", "tsv", "jsonl", "binary" } ;
+static const char * const kCommentModeNames[] = { "off", "skip", "keep" } ;
+static const char * const kNumberModeNames[] = { "plain", "c" } ;
+
+static void AppendNumber( std::string & out, uint64_t number ) {
+    char digits[24] ;
+    std::to_chars_result result = std::to_chars( digits, digits + sizeof( digits ), number ) ;
+    out.append( digits, ( size_t ) ( result.ptr - digits ) ) ;
+} // AppendNumber()
+
+static void AppendLittleEndian( std::string & out, uint64_t number, int bytes ) {
+    for ( int i = 0 ; i < bytes ; i++ ) {
+        out += ( char ) ( ( number >> ( 8 * i ) ) & 0xFF ) ;
+    } // for
+} // AppendLittleEndian()
+
+// Tabs and line ends would split a row, so they are escaped, and '\\' with them.
+static void AppendTsv( std::string & out, std::string_view text ) {
+
+    for ( size_t i = 0 ; i < text.length() ; i++ ) {
+        switch ( text[i] ) {
+        case '\t' : out += "\\t" ; break ;
+        case '\n' : out += "\\n" ; break ;
+        case '\r' : out += "\\r" ; break ;
+        case '\\' : out += "\\\\" ; break ;
+        default : out += text[i] ;
+        } // switch
+    } // for
+
+} // AppendTsv()
+
+static void AppendJson( std::string & out, std::string_view text ) {
+
+    static const char hex[] = "0123456789abcdef" ;
+
+    out += '"' ;
+    for ( size_t i = 0 ; i < text.length() ; i++ ) {
+        unsigned char ch = ( unsigned char ) text[i] ;
+        if ( ch == '"' || ch == '\\' ) {
+            out += '\\' ;
+            out += ( char ) ch ;
+        } // if
+        else if ( ch < 0x20 ) {
+            out += "\\u00" ;
+            out += hex[ch >> 4] ;
+            out += hex[ch & 0x0F] ;
+        } // else if
+        else {
+            out += ( char ) ch ;
+        } // else
+    } // for
+
+    out += '"' ;
+
+} // AppendJson()
+
+static void AppendTokenTsv( std::string & out, const std::string & path, const TokenView & token ) {
+
+    AppendTsv( out, path ) ;
+    out += '\t' ;
+    AppendNumber( out, token.line + 1 ) ;
+    out += '\t' ;
+    AppendNumber( out, token.column + 1 ) ;
+    out += '\t' ;
+    out += kTypeNames[token.type] ;
+    out += '\t' ;
+    AppendTsv( out, token.token ) ;
+    out += '\n' ;
+
+} // AppendTokenTsv()
+
+static void AppendTokenJson( std::string & out, const std::string & path, const TokenView & token ) {
+
+    out += "{\"file\":" ;
+    AppendJson( out, path ) ;
+    out += ",\"line\":" ;
+    AppendNumber( out, token.line + 1 ) ;
+    out += ",\"column\":" ;
+    AppendNumber( out, token.column + 1 ) ;
+    out += ",\"type\":\"" ;
+    out += kTypeNames[token.type] ;
+    out += "\",\"token\":" ;
+    AppendJson( out, token.token ) ;
+
+    if ( token.type == INTEGER ) {
+        char digits[24] ;
+        std::to_chars_result result = std::to_chars( digits, digits + sizeof( digits ), token.iValue ) ;
+        out += ",\"value\":" ;
+        out.append( digits, ( size_t ) ( result.ptr - digits ) ) ;
     } // if
+    else if ( token.type == DOUBLE ) {
+        out += ",\"value\":" ;
+        if ( isfinite( token.dValue ) ) {
+            char digits[32] ;
+            std::to_chars_result result = std::to_chars( digits, digits + sizeof( digits ), token.dValue ) ;
+            out.append( digits, ( size_t ) ( result.ptr - digits ) ) ;
+        } // if
+        else {
+            out += "null" ;
+        } // else
+    } // else if
+    else if ( token.type == STRING || token.type == CHAR ) {
+        out += ",\"contents\":" ;
+        AppendJson( out, token.contents ) ;
+    } // else if
     else {
-        std::cout << "The file can not open !" << "\n" ;
+        ;
     } // else
 
-    delete tp ;
-    tp = NULL ;
+    out += "}\n" ;
 
-} // main()
+} // AppendTokenJson()
+
+// Cuts one file and writes it in "options.format" into "result".
+static void ProcessFile( TokenProcessor & tp, const std::string & path, const CliOptions & options, FileResult & result ) {
+
+    tp.Clear() ;
+
+    if ( !tp.CutMappedFile( path == "-" ? "/dev/stdin" : path ) ) {
+        return ;
+    } // if
+
+    MemorySink sink ;
+    TokenView tokens[256] ;
+    size_t count = 0 ;
+
+    if ( tp.GetLineCount() > 0 ) { // up to the end of the last line, without its '\n'
+        std::string_view last = tp.GetLine( tp.GetLineCount() - 1 ) ;
+        result.bytes = ( size_t ) ( last.data() + last.length() - tp.GetLine( 0 ).data() ) ;
+    } // if
+
+    if ( options.format == FORMAT_TEXT ) {
+        if ( options.header ) {
+            result.output += "==> " + path + " <==\n" ;
+        } // if
+        tp.Output( sink, true, true ) ;
+        result.output += sink.Data() ;
+        result.tokens = tp.Skip( ( size_t ) -1 ) ;
+    } // if
+    else if ( options.format == FORMAT_BINARY ) {
+        if ( !tp.SaveTokens( sink ) ) {
+            result.error = "can not save the tokens of" ;
+            return ;
+        } // if
+        AppendLittleEndian( result.output, path.length(), 4 ) ;
+        result.output += path ;
+        AppendLittleEndian( result.output, sink.Data().length(), 8 ) ;
+        result.output += sink.Data() ;
+        result.tokens = tp.Skip( ( size_t ) -1 ) ;
+    } // else if
+    else {
+        while ( ( count = tp.GetTokens( tokens, 256 ) ) > 0 ) {
+            for ( size_t i = 0 ; i < count ; i++ ) {
+                if ( options.format == FORMAT_TSV ) {
+                    AppendTokenTsv( result.output, path, tokens[i] ) ;
+                } // if
+                else {
+                    AppendTokenJson( result.output, path, tokens[i] ) ;
+                } // else
+            } // for
+            result.tokens += count ;
+        } // while
+    } // else
+
+    result.successOrNot = true ;
+
+} // ProcessFile()
+
+static bool GetOption( int argc, char * argv[], int & i, const char * name, std::string & value ) {
+
+    size_t length = strlen( name ) ;
+
+    if ( strncmp( argv[i], name, length ) != 0 ) {
+        return false ;
+    } // if
+    else if ( argv[i][length] == '=' ) {
+        value = argv[i] + length + 1 ;
+        return true ;
+    } // else if
+    else if ( argv[i][length] == '\0' && i + 1 < argc ) {
+        value = argv[++i] ;
+        return true ;
+    } // else if
+    else {
+        return false ;
+    } // else
 
+} // GetOption()
 
+// The index of "value" in "names", or -1.
+static int FindName( const std::string & value, const char * const names[], int count ) {
+
+    for ( int i = 0 ; i < count ; i++ ) {
+        if ( value == names[i] ) {
+            return i ;
+        } // if
+    } // for
+
+    return -1 ;
+
+} // FindName()
+
+static int Usage( const char * program ) {
+    std::cerr << "usage: " << program << " [--format=text|tsv|jsonl|binary] [--jobs N] [--comments=off|skip|keep]"
+              << " [--numbers=plain|c] [--stats] [file ...]\n" ;
+    return 2 ;
+} // Usage()
+
+int main( int argc, char * argv[] ) {
+
+    CliOptions options ;
+    std::vector<std::string> paths ;
+    std::string value ;
+
+    for ( int i = 1 ; i < argc ; i++ ) {
+        if ( strcmp( argv[i], "--stats" ) == 0 ) {
+            options.stats = true ;
+        } // if
+        else if ( GetOption( argc, argv, i, "--format", value ) ) {
+            options.format = FindName( value, kFormatNames, 4 ) ;
+        } // else if
+        else if ( GetOption( argc, argv, i, "--jobs", value ) || GetOption( argc, argv, i, "-j", value ) ) {
+            options.jobs = ( unsigned ) strtoul( value.c_str(), NULL, 10 ) ;
+            if ( options.jobs == 0 ) {
+                options.jobs = std::thread::hardware_concurrency() ;
+            } // if
+            if ( options.jobs == 0 ) {
+                options.jobs = 1 ;
+            } // if
+        } // else if
+        else if ( GetOption( argc, argv, i, "--comments", value ) ) {
+            options.commentMode = FindName( value, kCommentModeNames, 3 ) ;
+        } // else if
+        else if ( GetOption( argc, argv, i, "--numbers", value ) ) {
+            options.numberMode = FindName( value, kNumberModeNames, 2 ) ;
+        } // else if
+        else if ( argv[i][0] == '-' && argv[i][1] != '\0' ) {
+            return Usage( argv[0] ) ;
+        } // else if
+        else {
+            paths.push_back( argv[i] ) ;
+        } // else
+    } // for
+
+    if ( options.format < 0 || options.commentMode < 0 || options.numberMode < 0 ) {
+        return Usage( argv[0] ) ;
+    } // if
+
+    if ( paths.empty() ) {
+        paths.push_back( "-" ) ;
+    } // if
+
+    options.header = ( paths.size() > 1 ) ;
+
+    // Workers cut files in any order, at most "window" files ahead of the one written next;
+    // this thread writes each one as soon as the ones before it are written.
+    std::vector<FileResult> results( paths.size() ) ;
+    std::mutex mutex ;
+    std::condition_variable changed ;
+    std::atomic<size_t> nextFile( 0 ) ;
+    size_t written = 0 ;
+    size_t window = ( size_t ) options.jobs * 4 ;
+    unsigned workerCount = ( paths.size() < options.jobs ? ( unsigned ) paths.size() : options.jobs ) ;
+
+    auto work = [&]() {
+
+        TokenProcessor tp ;
+        tp.SetCommentMode( options.commentMode ) ;
+        tp.SetNumberMode( options.numberMode ) ;
+        tp.SetThreadCount( paths.size() == 1 ? options.jobs : 1 ) ;
+
+        for ( size_t i = nextFile++ ; i < paths.size() ; i = nextFile++ ) {
+
+            {
+                std::unique_lock<std::mutex> lock( mutex ) ;
+                changed.wait( lock, [&]() { return i < written + window ; } ) ;
+            } // block
+
+            FileResult result ;
+            ProcessFile( tp, paths[i], options, result ) ;
+
+            std::lock_guard<std::mutex> lock( mutex ) ;
+            result.done = true ;
+            results[i] = std::move( result ) ;
+            changed.notify_all() ;
+
+        } // for
+
+    } ; // work
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now() ;
+    std::vector<std::thread> workers ;
+
+    for ( unsigned i = 0 ; i < workerCount ; i++ ) {
+        workers.push_back( std::thread( work ) ) ;
+    } // for
+
+    static char outputBuffer[1 << 16] ;
+    setvbuf( stdout, outputBuffer, _IOFBF, sizeof( outputBuffer ) ) ;
+
+    size_t bytes = 0, tokens = 0 ;
+    int exitCode = 0 ;
+
+    while ( written < paths.size() ) {
+
+        FileResult result ;
+
+        {
+            std::unique_lock<std::mutex> lock( mutex ) ;
+            changed.wait( lock, [&]() { return results[written].done ; } ) ;
+            result = std::move( results[written] ) ;
+        } // block
+
+        if ( !result.successOrNot ) {
+            std::cerr << argv[0] << ": " << result.error << " " << paths[written] << "\n" ;
+            exitCode = 1 ;
+        } // if
+
+        fwrite( result.output.data(), 1, result.output.length(), stdout ) ;
+        bytes += result.bytes ;
+        tokens += result.tokens ;
+
+        std::lock_guard<std::mutex> lock( mutex ) ;
+        written++ ;
+        changed.notify_all() ;
+
+    } // while
+
+    for ( size_t i = 0 ; i < workers.size() ; i++ ) {
+        workers[i].join() ;
+    } // for
+
+    fflush( stdout ) ;
+
+    if ( options.stats ) {
+        double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() ;
+        fprintf( stderr, "%zu files, %zu bytes, %zu tokens in %.3f s: %.1f MB/s, %.0f tokens/s\n",
+                 paths.size(), bytes, tokens, seconds, bytes / seconds / 1e6, tokens / seconds ) ;
+    } // if
+
+    return exitCode ;
+
+} // main()
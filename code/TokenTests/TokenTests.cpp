@@ -0,0 +1,234 @@
+﻿# include "TokenTests.h"
+
+# include <fstream>
+# include <iterator>
+# include <stdio.h>
+# include <string.h>
+
+/*
+ * Checks TokenProcessor_v3: every way of cutting against CutLine() on the same lines,
+ * and the tokens of known inputs.
+ *
+ *   TokenTests [--dir=PATH] [CASE...]
+ *
+ * Runs the named cases, or all of them, writes its files to PATH and prints each failure.
+ * Exits with 1 if any check failed.
+ */
+
+struct TestCase {
+    const char * name ;
+    void ( * run )( TestContext & context ) ;
+} ; // struct TestCase
+
+// A NULL name ends the table.
+static const TestCase kCases[] = {
+    { "files", TestFiles },
+    { "stream", TestStream },
+    { "char_classes", TestCharClasses },
+    { "operators", TestOperators },
+    { "symbols", TestSymbols },
+    { "numbers", TestNumbers },
+    { "c_numbers", TestCNumbers },
+    { "scan_levels", TestScanLevels },
+    { "parallel", TestParallel },
+    { "columns", TestColumns },
+    { "arena", TestArena },
+    { "positions", TestPositions },
+    { "comments", TestComments },
+    { "replace_lines", TestReplaceLines },
+    { "cursors", TestCursors },
+    { "marks", TestMarks },
+    { "output", TestOutput },
+    { "policies", TestPolicies },
+    { "stats", TestStats },
+    { "cache", TestCache },
+    { "line_limit", TestLineLimit },
+    { NULL, NULL }
+} ;
+
+# define COUNT_OF( array ) ( sizeof( array ) / sizeof( array[0] ) )
+
+// Pieces of lines that end comments, literals and numbers in the middle of others.
+// The long runs go through the SIMD kernels, which take 16 or 32 bytes at a time.
+static const char * const kPieces[] = {
+    "a", "b1", "12", "3.5", ".5", "/*", "*/", "//", "\\", "\"", "'", "x y", "\\\\", "+", "/", "*",
+    " ", "\"q\\", "e\\\"", "\r", "\t", "0x1F", "1e5", "07", "1'000", "0b101u", "1.5f", "12ULL",
+    "<<=", "->", "::", "#",
+    "an_identifier_long_enough_for_two_kernel_rounds",
+    "                                              ",
+    "123456789012345678901234567890123456789",
+    "\"a string with no escape, long enough for the kernels\""
+} ;
+
+bool TestContext::Check( bool ok, const std::string & what, const char * file, int line ) {
+
+    mChecks++ ;
+
+    if ( !ok ) {
+        mFailures++ ;
+        std::cout << file << ":" << line << ": " << mCase << ": " << what << "\n" ;
+    } // if
+
+    return ok ;
+
+} // TestContext::Check()
+
+// Prints the first line that differs, not the whole dumps.
+bool TestContext::CheckEqual( const std::string & got, const std::string & want, const std::string & what,
+                              const char * file, int line ) {
+
+    if ( got == want ) {
+        return Check( true, what, file, line ) ;
+    } // if
+
+    size_t start = 0, lineNumber = 1 ;
+    size_t length = ( got.length() < want.length() ? got.length() : want.length() ) ;
+
+    for ( size_t i = 0 ; i < length && got[i] == want[i] ; i++ ) {
+        if ( got[i] == '\n' ) {
+            start = i + 1 ;
+            lineNumber++ ;
+        } // if
+    } // for
+
+    size_t gotEnd = got.find( '\n', start ), wantEnd = want.find( '\n', start ) ;
+    std::ostringstream out ;
+
+    out << what << ", line " << lineNumber << " differs\n"
+        << "    got  [" << got.substr( start, gotEnd == std::string::npos ? std::string::npos : gotEnd - start ) << "]\n"
+        << "    want [" << want.substr( start, wantEnd == std::string::npos ? std::string::npos : wantEnd - start ) << "]" ;
+
+    return Check( false, out.str(), file, line ) ;
+
+} // TestContext::CheckEqual()
+
+std::string RandomLine( TestRandom & random ) {
+
+    std::string line ;
+    size_t pieces = random.Next( 7 ) ;
+
+    for ( size_t i = 0 ; i < pieces ; i++ ) {
+        line += kPieces[random.Next( COUNT_OF( kPieces ) )] ;
+    } // for
+
+    return line ;
+
+} // RandomLine()
+
+std::vector<std::string> RandomLines( TestRandom & random, size_t count ) {
+
+    std::vector<std::string> lines ;
+
+    for ( size_t i = 0 ; i < count ; i++ ) {
+        lines.push_back( RandomLine( random ) ) ;
+    } // for
+
+    return lines ;
+
+} // RandomLines()
+
+// The lines as a file holds them, each one followed by '\n'.
+std::string JoinLines( const std::vector<std::string> & lines ) {
+
+    std::string text ;
+
+    for ( size_t i = 0 ; i < lines.size() ; i++ ) {
+        text += lines[i] ;
+        text += '\n' ;
+    } // for
+
+    return text ;
+
+} // JoinLines()
+
+bool WriteFile( const std::string & path, const std::string & text ) {
+
+    std::ofstream outFile( path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc ) ;
+    outFile.write( text.data(), ( std::streamsize ) text.length() ) ;
+    return outFile.good() ;
+
+} // WriteFile()
+
+std::string ReadFile( const std::string & path ) {
+
+    std::ifstream inFile( path.c_str(), std::ios::in | std::ios::binary ) ;
+    return std::string( std::istreambuf_iterator<char>( inFile ), std::istreambuf_iterator<char>() ) ;
+
+} // ReadFile()
+
+std::string DumpToken( const TokenView & token ) {
+
+    char number[64] ;
+    std::ostringstream out ;
+
+    snprintf( number, sizeof( number ), "%a", token.dValue ) ;
+    out << token.type << " " << token.line << ":" << token.column << " @" << token.offset
+        << " [" << token.token << "] {" << token.contents << "} " << token.iValue << " " << number
+        << " flags " << token.numberFlags << " symbol " << token.symbol << "\n" ;
+
+    return out.str() ;
+
+} // DumpToken()
+
+static bool GetOption( const char * arg, const char * name, std::string & value ) {
+
+    size_t length = strlen( name ) ;
+    if ( strncmp( arg, name, length ) == 0 && arg[length] == '=' ) {
+        value = arg + length + 1 ;
+        return true ;
+    } // if
+
+    return false ;
+
+} // GetOption()
+
+int main( int argc, char * argv[] ) {
+
+    std::string directory = "." ;
+    std::string value ;
+    std::vector<const TestCase *> cases ;
+
+    for ( int i = 1 ; i < argc ; i++ ) {
+        const TestCase * found = NULL ;
+        for ( const TestCase * test = kCases ; test->name != NULL ; test++ ) {
+            if ( strcmp( argv[i], test->name ) == 0 ) {
+                found = test ;
+            } // if
+        } // for
+
+        if ( found != NULL ) {
+            cases.push_back( found ) ;
+        } // if
+        else if ( GetOption( argv[i], "--dir", value ) ) {
+            directory = value ;
+        } // else if
+        else {
+            std::cerr << "usage: " << argv[0] << " [--dir=PATH] [CASE...]\ncases:" ;
+            for ( const TestCase * test = kCases ; test->name != NULL ; test++ ) {
+                std::cerr << " " << test->name ;
+            } // for
+
+            std::cerr << "\n" ;
+            return 1 ;
+        } // else
+    } // for
+
+    if ( cases.empty() ) {
+        for ( const TestCase * test = kCases ; test->name != NULL ; test++ ) {
+            cases.push_back( test ) ;
+        } // for
+    } // if
+
+    TestContext context( directory ) ;
+
+    for ( size_t i = 0 ; i < cases.size() ; i++ ) {
+        size_t failures = context.GetFailures() ;
+        context.Begin( cases[i]->name ) ;
+        cases[i]->run( context ) ;
+        std::cout << ( context.GetFailures() == failures ? "ok     " : "FAILED " ) << cases[i]->name << std::endl ;
+    } // for
+
+    std::cout << context.GetChecks() << " checks, " << context.GetFailures() << " failed" << std::endl ;
+    return ( context.GetFailures() == 0 ? 0 : 1 ) ;
+
+} // main()
@@ -0,0 +1,142 @@
+# ifndef TOKEN_TESTS_H_INCLUDED
+# define TOKEN_TESTS_H_INCLUDED
+
+# include <iostream>
+# include <sstream>
+# include <string>
+# include <vector>
+# include <stdint.h>
+# include <stddef.h>
+
+# include "../TokenProcessor_v3/TokenProcessor.h"
+
+/* TokenTests : checks TokenProcessor_v3 against itself and against known tokens */
+
+// Where test_input and test_output are; CMake gives the source directory.
+# ifndef TOKEN_TESTS_SOURCE_DIR
+# define TOKEN_TESTS_SOURCE_DIR "."
+# endif
+
+// What the case running now has found. TEST_CHECK and TEST_EQUAL report where they failed and go on.
+class TestContext {
+
+private:
+
+    std::string mDirectory ;
+    std::string mCase ;
+    size_t mChecks ;
+    size_t mFailures ;
+
+public:
+
+    TestContext( const std::string & directory ) : mDirectory( directory ), mCase( "" ), mChecks( 0 ), mFailures( 0 ) {} // constructor
+
+    void Begin( const std::string & name ) { mCase = name ; }
+    size_t GetChecks() const { return mChecks ; }
+    size_t GetFailures() const { return mFailures ; }
+
+    // A file of the case in the directory given by "--dir".
+    std::string Path( const std::string & name ) const { return mDirectory + "/TokenTests_" + mCase + "_" + name ; }
+
+    bool Check( bool ok, const std::string & what, const char * file, int line ) ;
+    bool CheckEqual( const std::string & got, const std::string & want, const std::string & what,
+                     const char * file, int line ) ;
+
+} ; // class TestContext
+
+# define TEST_CHECK( context, ok, what ) ( context ).Check( ( ok ), ( what ), __FILE__, __LINE__ )
+# define TEST_EQUAL( context, got, want, what ) ( context ).CheckEqual( ( got ), ( want ), ( what ), __FILE__, __LINE__ )
+
+// The same numbers on every run, like CorpusRandom of TokenBenchmark.
+class TestRandom {
+
+private:
+
+    uint64_t mState ;
+
+public:
+
+    explicit TestRandom( uint64_t seed ) : mState( seed * 2 + 1 ) {} // constructor
+
+    size_t Next( size_t bound ) {
+        mState = mState * 6364136223846793005ULL + 1442695040888963407ULL ;
+        return ( size_t ) ( ( mState >> 33 ) % bound ) ;
+    } // Next()
+
+} ; // class TestRandom
+
+std::string RandomLine( TestRandom & random ) ;
+std::vector<std::string> RandomLines( TestRandom & random, size_t count ) ;
+std::string JoinLines( const std::vector<std::string> & lines ) ;
+bool WriteFile( const std::string & path, const std::string & text ) ;
+std::string ReadFile( const std::string & path ) ;
+
+// Every field of a view on one line; dValue exactly, by "%a".
+std::string DumpToken( const TokenView & token ) ;
+
+// The tokens left in "tp", read by GetToken().
+template <class Processor>
+std::string DumpTokens( Processor & tp ) {
+
+    std::string text ;
+    TokenView token ;
+
+    while ( tp.GetToken( token ) ) {
+        text += DumpToken( token ) ;
+    } // while
+
+    return text ;
+
+} // DumpTokens()
+
+template <class Processor>
+std::string DumpLines( Processor & tp ) {
+
+    std::ostringstream out ;
+
+    for ( size_t i = 0 ; i < tp.GetLineCount() ; i++ ) {
+        out << "line " << i << " [" << tp.GetLine( i ) << "]\n" ;
+    } // for
+
+    return out.str() ;
+
+} // DumpLines()
+
+// Each line by CutLine(), then EndInput(): what the other ways of cutting are compared with.
+template <class Processor>
+void CutLines( Processor & tp, const std::vector<std::string> & lines ) {
+
+    for ( size_t i = 0 ; i < lines.size() ; i++ ) {
+        tp.CutLine( lines[i] ) ;
+    } // for
+
+    tp.EndInput() ;
+
+} // CutLines()
+
+/* The cases, see TokenTests.cpp for the list */
+
+void TestFiles( TestContext & context ) ;
+void TestStream( TestContext & context ) ;
+void TestScanLevels( TestContext & context ) ;
+void TestParallel( TestContext & context ) ;
+void TestReplaceLines( TestContext & context ) ;
+void TestCache( TestContext & context ) ;
+void TestLineLimit( TestContext & context ) ;
+
+void TestCharClasses( TestContext & context ) ;
+void TestOperators( TestContext & context ) ;
+void TestSymbols( TestContext & context ) ;
+void TestNumbers( TestContext & context ) ;
+void TestCNumbers( TestContext & context ) ;
+void TestColumns( TestContext & context ) ;
+void TestArena( TestContext & context ) ;
+void TestPositions( TestContext & context ) ;
+void TestComments( TestContext & context ) ;
+void TestCursors( TestContext & context ) ;
+void TestMarks( TestContext & context ) ;
+void TestOutput( TestContext & context ) ;
+void TestPolicies( TestContext & context ) ;
+void TestStats( TestContext & context ) ;
+
+# endif // TOKEN_TESTS_H_INCLUDED
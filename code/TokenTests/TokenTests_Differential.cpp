@@ -0,0 +1,680 @@
+﻿# include "TokenTests.h"
+
+# include <algorithm>
+# include <stdio.h>
+
+/* Every way of cutting the same lines has to give the tokens CutLine() gives. */
+
+// Tokens by GetToken() and by a cursor from the beginning, and the lines held.
+static std::string DumpAll( TokenProcessor & tp ) {
+
+    std::string text ;
+    TokenView token ;
+
+    tp.BackToBeginning() ;
+    text = DumpTokens( tp ) ;
+
+    TokenCursor cursor( tp ) ;
+    while ( cursor.GetToken( token ) ) {
+        text += DumpToken( token ) ;
+    } // while
+
+    return text + DumpLines( tp ) ;
+
+} // DumpAll()
+
+// What is read from the whole processor at once: Output(), OutputOriginal(), GetPosition() and GetColumns().
+static std::string DumpBulk( TokenProcessor & tp, size_t length ) {
+
+    std::ostringstream out ;
+    MemorySink tokens, original ;
+
+    tp.Output( tokens, true, true ) ;
+    tp.OutputOriginal( original, true ) ;
+    out << tokens.Data() << original.Data() ;
+
+    for ( size_t offset = 0 ; offset <= length ; offset++ ) {
+        size_t line = 0, column = 0 ;
+        bool found = tp.GetPosition( offset, line, column ) ;
+        out << found << " " << line << ":" << column << "\n" ;
+    } // for
+
+    const TokenColumns & columns = tp.GetColumns() ;
+
+    for ( size_t i = 0 ; i < columns.Size() ; i++ ) {
+        out << ( int ) columns.types[i] << " @" << columns.offsets[i] << " " << columns.lines[i]
+            << " [" << columns.Text( i ) << "] " << ( int ) columns.numberFlags[i] << " {"
+            << ( columns.contentsIndexes[i] == NO_CONTENTS ? std::string_view( "-" ) : columns.contents[columns.contentsIndexes[i]] )
+            << "}\n" ;
+    } // for
+
+    return out.str() ;
+
+} // DumpBulk()
+
+static std::string ModeName( const std::string & what, int mode ) {
+    return what + ", comment mode " + std::to_string( mode ) ;
+} // ModeName()
+
+void TestFiles( TestContext & context ) {
+
+    TestRandom random( 2 ) ;
+    std::string path = context.Path( "source.txt" ) ;
+
+    for ( int mode = COMMENTS_OFF ; mode <= COMMENTS_KEEP ; mode++ ) {
+        for ( int round = 0 ; round < 6 ; round++ ) {
+
+            std::vector<std::string> lines = RandomLines( random, random.Next( 300 ) ) ;
+            std::string text = JoinLines( lines ) ;
+
+            if ( round % 2 == 1 && !lines.empty() && !lines.back().empty() ) {
+                text.erase( text.length() - 1 ) ; // the last line has no '\n'
+            } // if
+
+            TEST_CHECK( context, WriteFile( path, text ), "writing " + path ) ;
+
+            TokenProcessor reference, mapped, read ;
+            reference.SetCommentMode( mode ) ;
+            mapped.SetCommentMode( mode ) ;
+            read.SetCommentMode( mode ) ;
+
+            CutLines( reference, lines ) ;
+            TEST_CHECK( context, mapped.CutMappedFile( path ), "CutMappedFile() of " + path ) ;
+            std::fstream inFile( path.c_str(), std::ios::in ) ;
+            read.CutFile( inFile ) ;
+
+            std::string want = DumpAll( reference ) + DumpBulk( reference, text.length() ) ;
+            TEST_EQUAL( context, DumpAll( mapped ) + DumpBulk( mapped, text.length() ), want, ModeName( "CutMappedFile()", mode ) ) ;
+            TEST_EQUAL( context, DumpAll( read ) + DumpBulk( read, text.length() ), want, ModeName( "CutFile()", mode ) ) ;
+
+        } // for
+    } // for
+
+# if TOKEN_PROCESSOR_HAS_MMAP
+    // a directory opens but can not be read, and the lines held before are not kept as if it were
+    {
+        std::string cachePath = context.Path( "directory.tpk" ) ;
+        TokenProcessor mapped, cached ;
+
+        remove( cachePath.c_str() ) ;
+        mapped.CutLine( "held before" ) ;
+        TEST_CHECK( context, !mapped.CutMappedFile( "." ) && mapped.GetLineCount() == 0, "CutMappedFile() of a directory" ) ;
+        TEST_CHECK( context, !cached.CutCachedFile( ".", cachePath ) && cached.GetLineCount() == 0, "CutCachedFile() of a directory" ) ;
+        TEST_CHECK( context, ReadFile( cachePath ).empty(), "no cache of a directory" ) ;
+    } // block
+# endif
+
+    { // a file that can not be opened changes nothing
+        TokenProcessor tp ;
+        tp.CutLine( "held before" ) ;
+        TEST_CHECK( context, !tp.CutMappedFile( context.Path( "missing.txt" ) ) && tp.GetLineCount() == 1, "CutMappedFile() of a missing file" ) ;
+    } // block
+
+    remove( path.c_str() ) ;
+
+} // TestFiles()
+
+void TestStream( TestContext & context ) {
+
+    const size_t chunkSizes[] = { 1, 7, 4096 } ;
+    TestRandom random( 1 ) ;
+
+    for ( int mode = COMMENTS_OFF ; mode <= COMMENTS_KEEP ; mode++ ) {
+        for ( size_t i = 0 ; i < sizeof( chunkSizes ) / sizeof( chunkSizes[0] ) ; i++ ) {
+            for ( int round = 0 ; round < 4 ; round++ ) {
+
+                std::vector<std::string> lines = RandomLines( random, random.Next( 200 ) ) ;
+                std::string text = JoinLines( lines ) ;
+
+                if ( round % 2 == 1 && !lines.empty() && !lines.back().empty() ) {
+                    text.erase( text.length() - 1 ) ; // the last line has no '\n'
+                } // if
+
+                TokenProcessor reference, tp ;
+                reference.SetCommentMode( mode ) ;
+                reference.SetInterning( round >= 2 ) ;
+                CutLines( reference, lines ) ;
+
+                std::istringstream inStream( text ) ;
+                tp.SetCommentMode( mode ) ;
+                tp.SetInterning( round >= 2 ) ;
+                tp.OpenStream( inStream, chunkSizes[i] ) ;
+
+                // peeks pull the stream too, and must not change what comes next
+                std::string got, want ;
+                TokenView token ;
+
+                for ( bool more = true ; more ; ) {
+                    size_t ahead = random.Next( 4 ) ;
+                    bool gotPeek = tp.PeekToken( token, ahead ) ;
+                    got += ( gotPeek ? "peek " + DumpToken( token ) : "no peek\n" ) ;
+                    bool wantPeek = reference.PeekToken( token, ahead ) ;
+                    want += ( wantPeek ? "peek " + DumpToken( token ) : "no peek\n" ) ;
+
+                    bool gotMore = tp.GetToken( token ) ;
+                    got += ( gotMore ? DumpToken( token ) : "end\n" ) ;
+                    bool wantMore = reference.GetToken( token ) ;
+                    want += ( wantMore ? DumpToken( token ) : "end\n" ) ;
+                    more = gotMore && wantMore ;
+                } // for
+
+                TEST_EQUAL( context, got, want, ModeName( "chunk " + std::to_string( chunkSizes[i] ), mode ) ) ;
+
+            } // for
+        } // for
+    } // for
+
+} // TestStream()
+
+void TestScanLevels( TestContext & context ) {
+
+    // each kernel against the scalar one, from every index of buffers of every class
+    const ScanKernels * scalar = SelectScanKernels( SCAN_SCALAR ) ;
+    const char alphabet[] = " \t\r\n\v\fa_Z09\"'\\+.;\x80\xff" ;
+    TestRandom random( 4 ) ;
+
+    TEST_CHECK( context, scalar->level == SCAN_SCALAR, "SCAN_SCALAR is always run" ) ;
+
+    for ( int level = SCAN_SSE2 ; level <= SCAN_AVX2 ; level++ ) {
+
+        const ScanKernels * kernels = SelectScanKernels( level ) ;
+        size_t mismatches = 0 ;
+
+        TEST_CHECK( context, kernels->level <= level, "no better level than asked for" ) ;
+
+        for ( int round = 0 ; round < 200 ; round++ ) {
+
+            std::string buffer ;
+            size_t length = random.Next( 100 ) ;
+            size_t runClass = random.Next( sizeof( alphabet ) - 1 ) ;
+
+            for ( size_t i = 0 ; i < length ; i++ ) { // long runs of one class, ended by anything
+                size_t at = ( random.Next( 8 ) == 0 ? random.Next( sizeof( alphabet ) - 1 ) : runClass ) ;
+                buffer += alphabet[at] ;
+            } // for
+
+            const char * source = buffer.data() ;
+
+            for ( size_t index = 0 ; index <= length ; index++ ) {
+                mismatches += ( kernels->skipWhite( source, index, length ) != scalar->skipWhite( source, index, length ) ) ;
+                mismatches += ( kernels->identifierEnd( source, index, length ) != scalar->identifierEnd( source, index, length ) ) ;
+                mismatches += ( kernels->digitEnd( source, index, length ) != scalar->digitEnd( source, index, length ) ) ;
+                mismatches += ( kernels->stringStop( source, index, length, '\"' ) != scalar->stringStop( source, index, length, '\"' ) ) ;
+                mismatches += ( kernels->stringStop( source, index, length, '\'' ) != scalar->stringStop( source, index, length, '\'' ) ) ;
+            } // for
+
+        } // for
+
+        TEST_CHECK( context, mismatches == 0, "kernels of level " + std::to_string( kernels->level ) + " end runs where the scalar ones do" ) ;
+
+    } // for
+
+    // the processor at each level, with the default classes and with one the kernels do not know
+    for ( int changed = 0 ; changed < 2 ; changed++ ) {
+        for ( int mode = COMMENTS_OFF ; mode <= COMMENTS_KEEP ; mode++ ) {
+
+            std::vector<std::string> lines = RandomLines( random, 400 ) ;
+            std::string want ;
+
+            for ( int level = SCAN_SCALAR ; level <= SCAN_AVX2 ; level++ ) {
+
+                TokenProcessor tp ;
+                tp.SetScanLevel( level ) ;
+                tp.SetCommentMode( mode ) ;
+                if ( changed == 1 ) {
+                    tp.SetCharClass( '_', CLASS_DELIMITER ) ;
+                    tp.SetCharClass( '\r', CLASS_IDENTIFIER ) ;
+                } // if
+
+                CutLines( tp, lines ) ;
+
+                if ( level == SCAN_SCALAR ) {
+                    want = DumpAll( tp ) ;
+                } // if
+                else {
+                    TEST_EQUAL( context, DumpAll( tp ), want, ModeName( ( changed ? "changed classes, level " : "level " ) +
+                                                                         std::to_string( tp.GetScanLevel() ), mode ) ) ;
+                } // else
+
+            } // for
+
+        } // for
+    } // for
+
+} // TestScanLevels()
+
+void TestParallel( TestContext & context ) {
+
+    const unsigned threadCounts[] = { 2, 3, 8 } ;
+    TestRandom random( 3 ) ;
+    std::string path = context.Path( "source.txt" ) ;
+
+    for ( int round = 0 ; round < 4 ; round++ ) {
+
+        std::vector<std::string> lines = RandomLines( random, 1500 + random.Next( 1000 ) ) ;
+        std::string text = JoinLines( lines ) ;
+
+        TEST_CHECK( context, text.length() >= 4 * TOKEN_PROCESSOR_PARALLEL_MIN_BYTES, "the source is long enough to be split" ) ;
+        TEST_CHECK( context, WriteFile( path, text ), "writing " + path ) ;
+
+        int numberMode = ( round % 2 == 0 ? NUMBERS_PLAIN : NUMBERS_C ) ;
+        bool interning = ( round >= 2 ) ;
+
+        TokenProcessor reference ;
+        reference.SetNumberMode( numberMode ) ;
+        reference.SetInterning( interning ) ;
+        CutLines( reference, lines ) ;
+        std::string want = DumpAll( reference ) + DumpBulk( reference, text.length() ) ;
+
+        for ( size_t i = 0 ; i < sizeof( threadCounts ) / sizeof( threadCounts[0] ) ; i++ ) {
+            TokenArena arena ;
+            TokenProcessor tp ;
+            tp.SetThreadCount( threadCounts[i] ) ;
+            tp.SetNumberMode( numberMode ) ;
+            tp.SetInterning( interning ) ;
+            if ( i == 1 ) {
+                tp.SetArena( &arena ) ;
+            } // if
+
+            TEST_CHECK( context, tp.CutMappedFile( path ), "CutMappedFile() of " + path ) ;
+            TEST_EQUAL( context, DumpAll( tp ) + DumpBulk( tp, text.length() ), want,
+                        std::to_string( threadCounts[i] ) + " threads, round " + std::to_string( round ) ) ;
+        } // for
+
+    } // for
+
+    remove( path.c_str() ) ;
+
+} // TestParallel()
+
+// Edits a processor at random, each time against a fresh cut of the edited lines.
+// It starts from CutLine(), from the same after EndInput(), from a mapped file and from a cache.
+void TestReplaceLines( TestContext & context ) {
+
+    std::string path = context.Path( "source.txt" ), cachePath = context.Path( "source.tpk" ) ;
+    TestRandom random( 5 ) ;
+
+    for ( int mode = COMMENTS_OFF ; mode <= COMMENTS_KEEP ; mode++ ) {
+        for ( int start = 0 ; start < 4 ; start++ ) {
+
+            bool ended = ( start != 0 ) ;
+            std::vector<std::string> lines = RandomLines( random, random.Next( 60 ) ) ;
+
+            TokenProcessor tp ;
+            tp.SetCommentMode( mode ) ;
+
+            if ( start <= 1 ) {
+                for ( size_t i = 0 ; i < lines.size() ; i++ ) {
+                    tp.CutLine( lines[i] ) ;
+                } // for
+
+                if ( ended ) {
+                    tp.EndInput() ;
+                } // if
+            } // if
+            else {
+                WriteFile( path, JoinLines( lines ) ) ;
+                if ( start == 2 ) {
+                    tp.CutMappedFile( path ) ;
+                } // if
+                else {
+                    TokenProcessor writer ;
+                    remove( cachePath.c_str() ) ;
+                    writer.SetCommentMode( mode ) ;
+                    writer.CutCachedFile( path, cachePath ) ;
+                    tp.CutCachedFile( path, cachePath ) ;
+                } // else
+            } // else
+
+            for ( int edit = 0 ; edit < 150 ; edit++ ) {
+
+                size_t first = random.Next( lines.size() + 1 ) ;
+                size_t count = random.Next( std::min<size_t>( lines.size() - first, 4 ) + 1 ) ;
+                std::vector<std::string> newLines = RandomLines( random, random.Next( 4 ) ) ;
+                std::string what = ModeName( "start " + std::to_string( start ) + ", edit " + std::to_string( edit ), mode ) ;
+
+                if ( !TEST_CHECK( context, tp.ReplaceLines( first, count, newLines ), what + " is refused" ) ) {
+                    return ;
+                } // if
+
+                lines.erase( lines.begin() + ( ptrdiff_t ) first, lines.begin() + ( ptrdiff_t ) ( first + count ) ) ;
+                lines.insert( lines.begin() + ( ptrdiff_t ) first, newLines.begin(), newLines.end() ) ;
+
+                if ( edit % 13 == 5 ) { // more lines after an edit; after EndInput() only ReplaceLines() adds them
+                    std::string line = RandomLine( random ) ;
+                    lines.push_back( line ) ;
+                    if ( ended ) {
+                        tp.ReplaceLines( lines.size() - 1, 0, std::vector<std::string>( 1, line ) ) ;
+                    } // if
+                    else {
+                        tp.CutLine( line ) ;
+                    } // else
+                } // if
+
+                TokenProcessor reference ;
+                reference.SetCommentMode( mode ) ;
+                for ( size_t i = 0 ; i < lines.size() ; i++ ) {
+                    reference.CutLine( lines[i] ) ;
+                } // for
+
+                if ( ended ) {
+                    reference.EndInput() ;
+                } // if
+
+                std::string got = DumpAll( tp ), want = DumpAll( reference ) ;
+                if ( got == want && edit % 7 == 3 ) {
+                    size_t length = JoinLines( lines ).length() ;
+                    got = DumpBulk( tp, length ) ;
+                    want = DumpBulk( reference, length ) ;
+                } // if
+
+                if ( !TEST_EQUAL( context, got, want, what ) ) {
+                    return ;
+                } // if
+
+            } // for
+
+        } // for
+    } // for
+
+    remove( path.c_str() ) ;
+    remove( cachePath.c_str() ) ;
+
+} // TestReplaceLines()
+
+static std::string DumpCut( TokenProcessor & tp, size_t length ) {
+    return DumpAll( tp ) + DumpBulk( tp, length ) ;
+} // DumpCut()
+
+static std::string SavedTokens( TokenProcessor & tp ) {
+
+    MemorySink sink ;
+
+    if ( !tp.SaveTokens( sink ) ) {
+        return "not saved" ;
+    } // if
+
+    return sink.Data() ;
+
+} // SavedTokens()
+
+// "bad" in place of the cache at "cachePath" is not loaded: the source is cut, and the cache is written again.
+static void CheckDamaged( TestContext & context, const std::string & path, const std::string & cachePath,
+                          const std::string & bad, const std::string & bytes, const std::string & want, const std::string & what ) {
+
+    WriteFile( cachePath, bad ) ;
+
+    TokenProcessor tp ;
+    tp.SetCommentMode( COMMENTS_KEEP ) ;
+    TEST_CHECK( context, tp.CutCachedFile( path, cachePath ), "CutCachedFile() with " + what ) ;
+    TEST_EQUAL( context, DumpCut( tp, ReadFile( path ).length() ), want, "cut after " + what ) ;
+    TEST_CHECK( context, ReadFile( cachePath ) == bytes, "written again after " + what ) ;
+
+} // CheckDamaged()
+
+// A cache is loaded only for the same source and settings, and gives the tokens a cut gives.
+void TestCache( TestContext & context ) {
+
+    std::string path = context.Path( "source.txt" ), cachePath = context.Path( "source.tpk" ) ;
+    TestRandom random( 6 ) ;
+    std::vector<std::string> lines = RandomLines( random, 500 ) ;
+    std::string text = JoinLines( lines ) ;
+
+    TEST_CHECK( context, WriteFile( path, text ), "writing " + path ) ;
+    remove( cachePath.c_str() ) ;
+
+    TokenProcessor fresh ;
+    fresh.SetCommentMode( COMMENTS_KEEP ) ;
+    fresh.CutMappedFile( path ) ;
+    std::string want = DumpCut( fresh, text.length() ) ;
+    std::string saved = SavedTokens( fresh ) ;
+
+    { // no cache yet: it is cut and written
+        TokenProcessor tp ;
+        tp.SetCommentMode( COMMENTS_KEEP ) ;
+        TEST_CHECK( context, tp.CutCachedFile( path, cachePath ), "CutCachedFile() without a cache" ) ;
+        TEST_EQUAL( context, DumpCut( tp, text.length() ), want, "cut instead of loaded" ) ;
+        TEST_CHECK( context, ReadFile( cachePath ) == saved, "the cache written" ) ;
+    } // block
+
+    { // loaded, and saved again as it was
+        TokenProcessor tp ;
+        tp.SetCommentMode( COMMENTS_KEEP ) ;
+        TEST_CHECK( context, tp.CutCachedFile( path, cachePath ), "CutCachedFile() with a cache" ) ;
+        TEST_EQUAL( context, DumpCut( tp, text.length() ), want, "loaded" ) ;
+        TEST_CHECK( context, SavedTokens( tp ) == saved, "saved again after loading" ) ;
+    } // block
+
+    { // ids come from the table, not from the cache
+        TokenProcessor tp, reference ;
+        tp.SetCommentMode( COMMENTS_KEEP ) ;
+        reference.SetCommentMode( COMMENTS_KEEP ) ;
+        tp.GetSymbolTable().AddKeyword( "a" ) ;
+        reference.GetSymbolTable().AddKeyword( "a" ) ;
+        tp.SetInterning( true ) ;
+        reference.SetInterning( true ) ;
+        tp.CutCachedFile( path, cachePath ) ;
+        reference.CutMappedFile( path ) ;
+        TEST_EQUAL( context, DumpCut( tp, text.length() ), DumpCut( reference, text.length() ), "interning a loaded cache" ) ;
+    } // block
+
+    { // cut and edited after loading
+        TokenProcessor tp, reference ;
+        std::vector<std::string> newLines ;
+        newLines.push_back( "y \"q\\nz\" /* open" ) ;
+        newLines.push_back( "*/ 5" ) ;
+        tp.SetCommentMode( COMMENTS_KEEP ) ;
+        reference.SetCommentMode( COMMENTS_KEEP ) ;
+        tp.CutCachedFile( path, cachePath ) ;
+        reference.CutMappedFile( path ) ;
+        tp.ReplaceLines( 3, 2, newLines ) ;
+        reference.ReplaceLines( 3, 2, newLines ) ;
+        tp.CutLine( "x = \"a\\tb\" ; // c" ) ;
+        reference.CutLine( "x = \"a\\tb\" ; // c" ) ;
+        TEST_EQUAL( context, DumpAll( tp ), DumpAll( reference ), "edited after loading" ) ;
+    } // block
+
+    // damaged caches are not loaded, the file is cut and the cache written again
+    std::string bytes = ReadFile( cachePath ) ;
+
+    for ( int damage = 0 ; damage < 5 ; damage++ ) {
+
+        std::string bad = bytes ;
+        if ( damage == 0 ) {
+            bad.erase( bad.length() - 1 ) ;
+        } // if
+        else if ( damage == 1 ) {
+            bad += 'x' ;
+        } // else if
+        else if ( damage == 2 ) {
+            bad[4] ^= 1 ; // the version
+        } // else if
+        else if ( damage == 3 ) {
+            bad.resize( 40 ) ;
+        } // else if
+        else {
+            bad.clear() ;
+        } // else
+
+        CheckDamaged( context, path, cachePath, bad, bytes, want, "damage " + std::to_string( damage ) ) ;
+
+    } // for
+
+    // any byte of a small cache changed, and a cache cut short, are never loaded
+    std::string smallPath = context.Path( "small.txt" ), smallCachePath = context.Path( "small.tpk" ) ;
+    std::vector<std::string> smallLines = RandomLines( random, 6 ) ;
+
+    smallLines.push_back( "x = 0x1F + 3.5e2 + 12 ; // note" ) ;
+    smallLines.push_back( "s = \"a\\tb\" + \"plain\" + 'c' ; /* block" ) ;
+    smallLines.push_back( "   comment */ y = 12 ;" ) ;
+    WriteFile( smallPath, JoinLines( smallLines ) ) ;
+    remove( smallCachePath.c_str() ) ;
+
+    TokenProcessor small ;
+    small.SetCommentMode( COMMENTS_KEEP ) ;
+    small.CutCachedFile( smallPath, smallCachePath ) ;
+
+    std::string smallWant = DumpCut( small, ReadFile( smallPath ).length() ) ;
+    std::string smallBytes = ReadFile( smallCachePath ) ;
+
+    for ( size_t i = 0 ; i < smallBytes.length() ; i++ ) {
+        std::string bad = smallBytes ;
+        bad[i] ^= ( char ) ( i % 2 == 0 ? 0xFF : 0x01 ) ;
+        CheckDamaged( context, smallPath, smallCachePath, bad, smallBytes, smallWant, "byte " + std::to_string( i ) + " changed" ) ;
+    } // for
+
+    // with the hash of the rest made to match, the records are still checked: a changed byte is
+    // either cut again or loaded as tokens of the source, never read out of bounds
+    size_t payload = 5 ;
+    while ( payload < smallBytes.length() && ( smallBytes[payload] & 0x80 ) != 0 ) { // the source length
+        payload++ ;
+    } // while
+    payload += 1 + 24 ;
+
+    for ( size_t i = payload ; i < smallBytes.length() ; i++ ) {
+
+        std::string bad = smallBytes ;
+        bad[i] ^= ( char ) ( i % 2 == 0 ? 0xFF : 0x01 ) ;
+        uint64_t hash = HashBytes( bad.data() + payload, bad.length() - payload, 0 ) ;
+        for ( int j = 0 ; j < 8 ; j++ ) {
+            bad[payload - 8 + j] = ( char ) ( hash >> ( 8 * j ) ) ;
+        } // for
+        WriteFile( smallCachePath, bad ) ;
+
+        TokenProcessor tp ;
+        tp.SetCommentMode( COMMENTS_KEEP ) ;
+        TEST_CHECK( context, tp.CutCachedFile( smallPath, smallCachePath ), "CutCachedFile() with byte " + std::to_string( i ) + " changed and the hash matching" ) ;
+        std::string got = DumpCut( tp, ReadFile( smallPath ).length() ) ;
+
+        if ( ReadFile( smallCachePath ) == smallBytes ) {
+            TEST_EQUAL( context, got, smallWant, "cut again with byte " + std::to_string( i ) + " changed and the hash matching" ) ;
+        } // if
+
+    } // for
+
+    for ( size_t length = 0 ; length < smallBytes.length() ; length++ ) {
+        CheckDamaged( context, smallPath, smallCachePath, smallBytes.substr( 0, length ), smallBytes, smallWant,
+                      "the cache cut to " + std::to_string( length ) + " bytes" ) ;
+    } // for
+
+    remove( smallPath.c_str() ) ;
+    remove( smallCachePath.c_str() ) ;
+
+    TEST_CHECK( context, bytes.length() < text.length() / 2, "the cache is under half the size of the source" ) ;
+
+    { // other settings are another cut
+        TokenProcessor tp, reference ;
+        tp.SetCommentMode( COMMENTS_SKIP ) ;
+        reference.SetCommentMode( COMMENTS_SKIP ) ;
+        tp.CutCachedFile( path, cachePath ) ;
+        reference.CutMappedFile( path ) ;
+        TEST_EQUAL( context, DumpCut( tp, text.length() ), DumpCut( reference, text.length() ), "another comment mode" ) ;
+        TEST_CHECK( context, ReadFile( cachePath ) == SavedTokens( reference ), "written for another comment mode" ) ;
+    } // block
+
+    { // and so is another source of the same length
+        std::string changed = text ;
+        changed[changed.find( 'a' )] = 'b' ;
+        WriteFile( path, changed ) ;
+
+        TokenProcessor tp, reference ;
+        tp.SetCommentMode( COMMENTS_SKIP ) ;
+        reference.SetCommentMode( COMMENTS_SKIP ) ;
+        tp.CutCachedFile( path, cachePath ) ;
+        reference.CutMappedFile( path ) ;
+        TEST_EQUAL( context, DumpCut( tp, changed.length() ), DumpCut( reference, changed.length() ), "a changed source" ) ;
+    } // block
+
+    remove( path.c_str() ) ;
+    remove( cachePath.c_str() ) ;
+
+} // TestCache()
+
+// TokenTests is built with a small TOKEN_PROCESSOR_MAX_LINES: every way of cutting takes that many
+// lines, and one more clears the processor and fails instead of wrapping a token's line.
+void TestLineLimit( TestContext & context ) {
+
+    std::string path = context.Path( "lines.txt" ), cachePath = context.Path( "lines.tpk" ) ;
+    std::vector<std::string> lines( TOKEN_PROCESSOR_MAX_LINES, "x" ) ;
+
+    for ( int more = 0 ; more <= 1 ; more++ ) {
+
+        bool fits = ( more == 0 ) ;
+        std::string what = ( fits ? " of as many lines as are taken" : " of one line too many" ) ;
+
+        lines.resize( TOKEN_PROCESSOR_MAX_LINES + more, "x" ) ;
+        TEST_CHECK( context, WriteFile( path, JoinLines( lines ) ), "writing " + path ) ;
+        remove( cachePath.c_str() ) ;
+
+        for ( unsigned threads = 1 ; threads <= 4 ; threads += 3 ) { // 4 cuts the file in parallel
+            TokenProcessor tp ;
+            tp.SetThreadCount( threads ) ;
+            TEST_CHECK( context, tp.CutMappedFile( path ) == fits, "CutMappedFile()" + what ) ;
+            TEST_CHECK( context, tp.GetLineCount() == ( fits ? lines.size() : 0 ), "the lines after CutMappedFile()" + what ) ;
+        } // for
+
+        { // the cache is not written either
+            TokenProcessor tp ;
+            TEST_CHECK( context, tp.CutCachedFile( path, cachePath ) == fits, "CutCachedFile()" + what ) ;
+            TEST_CHECK( context, tp.GetLineCount() == ( fits ? lines.size() : 0 ), "the lines after CutCachedFile()" + what ) ;
+            TEST_CHECK( context, ReadFile( cachePath ).empty() != fits, "the cache" + what ) ;
+        } // block
+
+        {
+            TokenProcessor tp ;
+            std::fstream inFile( path.c_str(), std::ios::in ) ;
+            TEST_CHECK( context, tp.CutFile( inFile ) == fits, "CutFile()" + what ) ;
+            TEST_CHECK( context, tp.GetLineCount() == ( fits ? lines.size() : 0 ), "the lines after CutFile()" + what ) ;
+        } // block
+
+        {
+            TokenProcessor tp ;
+            bool cut = true ;
+            for ( size_t i = 0 ; i < lines.size() && cut ; i++ ) {
+                cut = tp.CutLine( lines[i] ) ;
+            } // for
+            TEST_CHECK( context, cut == fits, "CutLine()" + what ) ;
+            TEST_CHECK( context, tp.GetLineCount() == ( fits ? lines.size() : 0 ), "the lines after CutLine()" + what ) ;
+        } // block
+
+        { // a stream holds only a window of lines, and gives every token however many lines it has
+            TokenProcessor tp ;
+            std::istringstream in( JoinLines( lines ) + JoinLines( lines ) ) ;
+            TokenView token ;
+            size_t count = 0, lastLine = 0 ;
+            tp.OpenStream( in, 64 ) ;
+            while ( tp.GetToken( token ) ) {
+                count++ ;
+                lastLine = token.line ;
+            } // while
+            TEST_CHECK( context, count == 2 * lines.size() && lastLine == count - 1, "the tokens of a stream twice" + what ) ;
+        } // block
+
+        { // but empty lines are held until the next token, and as many as that are refused
+            TokenProcessor tp ;
+            std::istringstream in( std::string( lines.size() - 1, '\n' ) + "x\n" ) ;
+            TokenView token ;
+            bool got = false ;
+            tp.OpenStream( in, 64 ) ;
+            got = tp.GetToken( token ) ;
+            TEST_CHECK( context, got == fits && ( !fits || token.line == lines.size() - 1 ), "a stream of empty lines" + what ) ;
+            TEST_CHECK( context, !tp.GetToken( token ) && ( fits || tp.GetLineCount() == 0 ), "the end of a stream of empty lines" + what ) ;
+        } // block
+
+    } // for
+
+    { // lines replaced may not make too many either, and nothing is changed then
+        TokenProcessor tp ;
+        std::vector<std::string> two( 2, "y" ) ;
+        lines.resize( TOKEN_PROCESSOR_MAX_LINES - 1 ) ;
+        CutLines( tp, lines ) ;
+        TEST_CHECK( context, tp.ReplaceLines( 5, 1, two ), "ReplaceLines() up to as many lines as are taken" ) ;
+        TEST_CHECK( context, !tp.ReplaceLines( 5, 0, two ), "ReplaceLines() of one line too many" ) ;
+        TEST_CHECK( context, tp.GetLineCount() == TOKEN_PROCESSOR_MAX_LINES, "the lines after ReplaceLines()" ) ;
+        TEST_EQUAL( context, std::string( tp.GetLine( 6 ) ), "y", "the lines replaced" ) ;
+    } // block
+
+    remove( path.c_str() ) ;
+    remove( cachePath.c_str() ) ;
+
+} // TestLineLimit()
@@ -0,0 +1,874 @@
+﻿# include "TokenTests.h"
+
+# include <stdio.h>
+
+/* Known inputs and the tokens they have to give. */
+
+// "type:text" of each token left, and "{contents}" after a STRING or a CHAR.
+template <class Processor>
+static std::string Brief( Processor & tp ) {
+
+    std::string text ;
+    TokenView token ;
+
+    while ( tp.GetToken( token ) ) {
+        text += ( text.empty() ? "" : " " ) + std::to_string( token.type ) + ":" + std::string( token.token ) ;
+        if ( token.type == STRING || token.type == CHAR ) {
+            text += "{" + std::string( token.contents ) + "}" ;
+        } // if
+    } // while
+
+    return text ;
+
+} // Brief()
+
+template <class Processor>
+static std::string BriefLine( const std::string & line ) {
+
+    Processor tp ;
+
+    tp.CutLine( line ) ;
+    tp.EndInput() ;
+    return Brief( tp ) ;
+
+} // BriefLine()
+
+// The classes of a processor are its own, and the kernels stop where they say.
+void TestCharClasses( TestContext & context ) {
+
+    TokenProcessor tp, other ;
+    const std::string line = "$x a_b an_identifier_long_enough_for_two_kernel_rounds" ;
+
+    TEST_EQUAL( context, BriefLine<TokenProcessor>( line ),
+                "4:$ 1:x 1:a_b 1:an_identifier_long_enough_for_two_kernel_rounds", "default classes" ) ;
+
+    tp.SetCharClass( '$', CLASS_IDENTIFIER_START | CLASS_IDENTIFIER ) ;
+    tp.SetCharClass( '_', CLASS_DELIMITER ) ;
+    TEST_CHECK( context, tp.GetCharClass( '$' ) == ( CLASS_IDENTIFIER_START | CLASS_IDENTIFIER ), "GetCharClass()" ) ;
+    TEST_CHECK( context, other.GetCharClass( '$' ) == CLASS_DELIMITER, "the classes of another processor" ) ;
+
+    for ( int level = SCAN_SCALAR ; level <= SCAN_AVX2 ; level++ ) {
+        tp.Clear() ;
+        tp.SetScanLevel( level ) ;
+        tp.CutLine( line ) ;
+        TEST_EQUAL( context, Brief( tp ),
+                    "1:$x 1:a 4:_ 1:b 1:an 4:_ 1:identifier 4:_ 1:long 4:_ 1:enough 4:_ 1:for 4:_ 1:two 4:_ 1:kernel 4:_ 1:rounds",
+                    "changed classes, level " + std::to_string( tp.GetScanLevel() ) ) ;
+    } // for
+
+    // a white character made a digit
+    tp.Clear() ;
+    tp.SetCharClass( ' ', CLASS_DIGIT | CLASS_IDENTIFIER ) ;
+    tp.CutLine( "1 2\t3" ) ;
+    TEST_EQUAL( context, Brief( tp ), "2:1 2 2:3", "a blank as a digit" ) ;
+
+} // TestCharClasses()
+
+void TestOperators( TestContext & context ) {
+
+    // the longest operator wins, and what is left is cut again
+    TEST_EQUAL( context, BriefLine<TokenProcessor>( "a<<=b->*c+++d" ), "1:a 4:<<= 1:b 4:->* 1:c 4:++ 4:+ 1:d", "longest match" ) ;
+    TEST_EQUAL( context, BriefLine<TokenProcessor>( "a<=>b" ), "1:a 4:<= 4:> 1:b", "no <=> by default" ) ;
+
+    TokenProcessor tp, other ;
+    TEST_CHECK( context, tp.AddOperator( "<=>" ), "AddOperator()" ) ;
+    tp.CutLine( "a<=>b<=c" ) ;
+    TEST_EQUAL( context, Brief( tp ), "1:a 4:<=> 1:b 4:<= 1:c", "an added operator" ) ;
+    other.CutLine( "a<=>b" ) ;
+    TEST_EQUAL( context, Brief( other ), "1:a 4:<= 4:> 1:b", "the operators of another processor" ) ;
+
+    // operators given to the constructor are the only ones
+    std::vector<std::string> operators ;
+    operators.push_back( "+=" ) ;
+    operators.push_back( "<=>" ) ;
+    TokenProcessor own( operators ) ;
+    own.CutLine( "a+=b<=>c<=d" ) ;
+    TEST_EQUAL( context, Brief( own ), "1:a 4:+= 1:b 4:<=> 1:c 4:< 4:= 1:d", "operators of the constructor" ) ;
+
+} // TestOperators()
+
+// Ids are dense and kept, keywords come first, and the tokens of a processor carry the ids of its table.
+void TestSymbols( TestContext & context ) {
+
+    SymbolTable symbols ;
+    const char * const keywords[] = { "if", "else", "while" } ;
+
+    for ( const char * keyword : keywords ) {
+        TEST_CHECK( context, symbols.AddKeyword( keyword ), std::string( "AddKeyword( " ) + keyword + " )" ) ;
+    } // for
+
+    TEST_CHECK( context, symbols.GetKeywordCount() == 3 && symbols.Size() == 3, "three keywords" ) ;
+    TEST_CHECK( context, symbols.AddKeyword( "else" ), "a keyword added again" ) ;
+
+    // names are numbered on from the keywords, in the order they are first seen
+    std::vector<std::string> names ;
+    for ( int i = 0 ; i < 1000 ; i++ ) { // enough for the slots to grow a few times
+        names.push_back( "name" + std::to_string( i ) ) ;
+    } // for
+
+    names.push_back( "" ) ;
+    names.push_back( "if_not" ) ;
+    names.push_back( "If" ) ;
+
+    bool dense = true, same = true, spelled = true ;
+    for ( size_t i = 0 ; i < names.size() ; i++ ) {
+        dense = dense && symbols.Intern( names[i].data(), names[i].length() ) == i + 3 ;
+    } // for
+
+    for ( size_t i = 0 ; i < names.size() ; i++ ) {
+        uint32_t id = symbols.Intern( names[i].data(), names[i].length() ) ;
+        same = same && id == i + 3 && symbols.Find( names[i] ) == id && !symbols.IsKeyword( id ) ;
+        spelled = spelled && symbols.GetName( id ) == names[i] ;
+    } // for
+
+    TEST_CHECK( context, dense, "new names get the next ids" ) ;
+    TEST_CHECK( context, same, "the same name gets the same id, and it is not a keyword" ) ;
+    TEST_CHECK( context, spelled, "GetName() of each id" ) ;
+    TEST_CHECK( context, symbols.Size() == names.size() + 3, "Size()" ) ;
+
+    for ( uint32_t id = 0 ; id < 3 ; id++ ) {
+        TEST_CHECK( context, symbols.IsKeyword( id ) && symbols.GetName( id ) == keywords[id] && symbols.Find( keywords[id] ) == id,
+                    std::string( "the keyword " ) + keywords[id] ) ;
+    } // for
+
+    TEST_CHECK( context, !symbols.AddKeyword( "for" ), "no keyword after other names" ) ;
+    TEST_CHECK( context, !symbols.AddKeyword( "name7" ), "a name that is not a keyword" ) ;
+    TEST_CHECK( context, symbols.Find( "for" ) == NO_SYMBOL, "Find() of a name never interned" ) ;
+    TEST_CHECK( context, symbols.GetName( ( uint32_t ) symbols.Size() ).empty() && symbols.GetName( NO_SYMBOL ).empty(),
+                "GetName() of an id out of range" ) ;
+
+    // tokens of two processors sharing the table
+    TokenProcessor tp, other ;
+    TokenView token ;
+    std::string got ;
+
+    tp.SetSymbolTable( &symbols ) ;
+    other.SetSymbolTable( &symbols ) ;
+    tp.SetInterning( true ) ;
+    other.SetInterning( true ) ;
+    tp.CutLine( "if name5 == fresh" ) ;
+    other.CutLine( "fresh while" ) ;
+
+    for ( TokenProcessor * processor : { &tp, &other } ) {
+        while ( processor->GetToken( token ) ) {
+            got += std::string( token.token ) + "=" + ( token.symbol == NO_SYMBOL ? "none" : std::to_string( token.symbol ) ) + " " ;
+        } // while
+    } // for
+
+    std::string fresh = std::to_string( names.size() + 3 ) ;
+    TEST_EQUAL( context, got, "if=0 name5=8 ===none fresh=" + fresh + " fresh=" + fresh + " while=2 ", "the ids of shared tokens" ) ;
+
+    symbols.Clear() ;
+    TEST_CHECK( context, symbols.Size() == 0 && symbols.GetKeywordCount() == 0 && symbols.Find( "if" ) == NO_SYMBOL, "Clear()" ) ;
+
+} // TestSymbols()
+
+// A number as it has to be: its text, its type, its value and its flags.
+struct KnownNumber {
+    std::string text ;
+    TokenType type ;
+    int64_t iValue ;
+    double dValue ;
+    int flags ;
+} ; // struct KnownNumber
+
+// "type value flags", the value of a DOUBLE in "%a" as DumpToken() has it.
+static std::string DescribeNumber( TokenType type, int64_t iValue, double dValue, int flags ) {
+
+    char number[64] ;
+
+    if ( type == DOUBLE ) {
+        snprintf( number, sizeof( number ), "%a", dValue ) ;
+    } // if
+    else {
+        snprintf( number, sizeof( number ), "%lld", ( long long ) iValue ) ;
+    } // else
+
+    return std::to_string( type ) + " " + number + " " + std::to_string( flags ) ;
+
+} // DescribeNumber()
+
+// Each number converted by ParseNumber() or ParseCNumber(), and cut alone in "numberMode".
+static void CheckNumbers( TestContext & context, const std::vector<KnownNumber> & known, int numberMode ) {
+
+    for ( size_t i = 0 ; i < known.size() ; i++ ) {
+
+        const KnownNumber & number = known[i] ;
+        std::string want = DescribeNumber( number.type, number.iValue, number.dValue, number.flags ) ;
+        const char * begin = number.text.data(), * end = begin + number.text.size() ;
+        int64_t iValue = 0 ;
+        double dValue = 0.0 ;
+        int flags = ( numberMode == NUMBERS_C ? ParseCNumber( begin, end, number.type, iValue, dValue ) :
+                                                ParseNumber( begin, end, number.type, iValue, dValue ) ) ;
+
+        TEST_EQUAL( context, DescribeNumber( number.type, iValue, dValue, flags ), want, "converting " + number.text ) ;
+
+        TokenProcessor tp ;
+        TokenView token ;
+
+        tp.SetNumberMode( numberMode ) ;
+        tp.CutLine( number.text ) ;
+        if ( TEST_CHECK( context, tp.GetToken( token ) && token.token == number.text, number.text + " cut as one token" ) ) {
+            TEST_EQUAL( context, DescribeNumber( token.type, token.iValue, token.dValue, token.numberFlags ), want, "cutting " + number.text ) ;
+        } // if
+
+    } // for
+
+} // CheckNumbers()
+
+// Numbers of NUMBERS_PLAIN, the default: decimal digits and at most one '.', no exponent.
+void TestNumbers( TestContext & context ) {
+
+    std::vector<KnownNumber> known = {
+        { "0", INTEGER, 0, 0.0, 0 },
+        { "42", INTEGER, 42, 0.0, 0 },
+        { "007", INTEGER, 7, 0.0, 0 }, // not octal
+        { "123456789012345678", INTEGER, 123456789012345678, 0.0, 0 }, // the 18 digits that always fit
+        { "9223372036854775807", INTEGER, INT64_MAX, 0.0, 0 },
+        { "9223372036854775808", INTEGER, INT64_MAX, 0.0, NUMBER_OVERFLOW },
+        { "123456789012345678901234567890", INTEGER, INT64_MAX, 0.0, NUMBER_OVERFLOW },
+        { "3.25", DOUBLE, 0, 3.25, 0 },
+        { "0.5", DOUBLE, 0, 0.5, 0 },
+        { "1" + std::string( 400, '0' ) + ".5", DOUBLE, 0, HUGE_VAL, NUMBER_OVERFLOW },
+        { "0." + std::string( 400, '0' ) + "1", DOUBLE, 0, 0.0, NUMBER_UNDERFLOW }
+    } ;
+
+    CheckNumbers( context, known, NUMBERS_PLAIN ) ;
+
+    // ParseNumber() reads an exponent the way atof() does, though only a cut DOUBLE comes to it
+    int64_t iValue = 0 ;
+    double dValue = 0.0 ;
+    const char * large = "1e400", * small = "1e-400" ;
+    TEST_CHECK( context, ParseNumber( large, large + 5, DOUBLE, iValue, dValue ) == NUMBER_OVERFLOW && dValue == HUGE_VAL, "1e400" ) ;
+    TEST_CHECK( context, ParseNumber( small, small + 6, DOUBLE, iValue, dValue ) == NUMBER_UNDERFLOW && dValue == 0.0, "1e-400" ) ;
+
+    // without NUMBERS_C an exponent is not part of the number
+    TEST_EQUAL( context, BriefLine<TokenProcessor>( "1e10 2.5e3" ), "2:1 1:e10 3:2.5 1:e3", "no exponent in NUMBERS_PLAIN" ) ;
+    TEST_EQUAL( context, BriefLine<TokenProcessor>( "1.2.3" ), "3:1.2 3:.3", "one '.' in a number" ) ;
+
+} // TestNumbers()
+
+// Literals of NUMBERS_C: prefixes, separators, exponents and suffixes, and what makes them MALFORMED.
+void TestCNumbers( TestContext & context ) {
+
+    std::vector<KnownNumber> known = {
+        { "42", INTEGER, 42, 0.0, 0 },
+        { "0x2a", INTEGER, 42, 0.0, 0 },
+        { "0X2A", INTEGER, 42, 0.0, 0 },
+        { "052", INTEGER, 42, 0.0, 0 },
+        { "0", INTEGER, 0, 0.0, 0 },
+        { "0b101010", INTEGER, 42, 0.0, 0 },
+        { "1'000'000", INTEGER, 1000000, 0.0, 0 },
+        { "0xFF'FF", INTEGER, 65535, 0.0, 0 },
+        { "0b1010'1010", INTEGER, 170, 0.0, 0 },
+        { "42u", INTEGER, 42, 0.0, NUMBER_UNSIGNED },
+        { "42L", INTEGER, 42, 0.0, NUMBER_LONG },
+        { "42ull", INTEGER, 42, 0.0, NUMBER_UNSIGNED | NUMBER_LONG_LONG },
+        { "42LLU", INTEGER, 42, 0.0, NUMBER_UNSIGNED | NUMBER_LONG_LONG },
+        { "123lL", INTEGER, 123, 0.0, NUMBER_MALFORMED }, // mixed case is not "ll"
+        { "123uu", INTEGER, 123, 0.0, NUMBER_MALFORMED },
+        { "123abc", INTEGER, 123, 0.0, NUMBER_MALFORMED },
+        { "09", INTEGER, 0, 0.0, NUMBER_MALFORMED }, // 9 is not octal
+        { "9223372036854775807", INTEGER, INT64_MAX, 0.0, 0 },
+        { "9223372036854775808", INTEGER, INT64_MAX, 0.0, NUMBER_OVERFLOW },
+        { "18446744073709551615u", INTEGER, -1, 0.0, NUMBER_UNSIGNED }, // all 64 bits
+        { "0xFFFFFFFFFFFFFFFF", INTEGER, -1, 0.0, 0 },
+        { "0x10000000000000000", INTEGER, -1, 0.0, NUMBER_OVERFLOW },
+        { "1e10", DOUBLE, 0, 1e10, 0 },
+        { "2.5e-3", DOUBLE, 0, 2.5e-3, 0 },
+        { "1'000.5", DOUBLE, 0, 1000.5, 0 },
+        { "1.5f", DOUBLE, 0, 1.5, NUMBER_FLOAT },
+        { "1.5L", DOUBLE, 0, 1.5, NUMBER_LONG },
+        { "1.5q", DOUBLE, 0, 1.5, NUMBER_MALFORMED },
+        { "0x1.8p1", DOUBLE, 0, 3.0, 0 },
+        { "0x1p-2", DOUBLE, 0, 0.25, 0 },
+        { "0x1.8", DOUBLE, 0, 1.5, NUMBER_MALFORMED }, // a hex DOUBLE needs 'p'
+        { "1e400", DOUBLE, 0, HUGE_VAL, NUMBER_OVERFLOW },
+        { "1e-400", DOUBLE, 0, 0.0, NUMBER_UNDERFLOW },
+        { "0x1p9999", DOUBLE, 0, HUGE_VAL, NUMBER_OVERFLOW }
+    } ;
+
+    CheckNumbers( context, known, NUMBERS_C ) ;
+
+    // a sign only right after the exponent
+    TokenProcessor tp ;
+    tp.SetNumberMode( NUMBERS_C ) ;
+    tp.CutLine( "1e+5-2 0x1p-2+1" ) ;
+    TEST_EQUAL( context, Brief( tp ), "3:1e+5 4:- 2:2 3:0x1p-2 4:+ 2:1", "signs after a number" ) ;
+
+} // TestCNumbers()
+
+void TestColumns( TestContext & context ) {
+
+    TestRandom random( 8 ) ;
+    TokenProcessor tp ;
+
+    tp.SetCommentMode( COMMENTS_KEEP ) ;
+    tp.SetNumberMode( NUMBERS_C ) ;
+    tp.SetInterning( true ) ;
+    CutLines( tp, RandomLines( random, 300 ) ) ;
+
+    for ( int round = 0 ; round < 3 ; round++ ) {
+
+        const TokenColumns & columns = tp.GetColumns() ;
+        TokenView token ;
+        size_t i = 0, mismatches = 0 ;
+
+        tp.BackToBeginning() ;
+        for ( ; tp.GetToken( token ) ; i++ ) {
+            if ( i >= columns.Size() ) {
+                mismatches++ ;
+                continue ;
+            } // if
+
+            std::string_view contents = ( columns.contentsIndexes[i] == NO_CONTENTS ? std::string_view() : columns.contents[columns.contentsIndexes[i]] ) ;
+            bool same = columns.types[i] == token.type && columns.offsets[i] == token.offset && columns.Text( i ) == token.token &&
+                        columns.lines[i] == token.line && columns.numberFlags[i] == token.numberFlags &&
+                        columns.symbols[i] == token.symbol && contents == token.contents &&
+                        ( token.type == DOUBLE ? columns.dValues[i] == token.dValue || token.dValue != token.dValue : columns.iValues[i] == token.iValue ) ;
+            mismatches += ( same ? 0 : 1 ) ;
+        } // for
+
+        TEST_CHECK( context, i == columns.Size(), "one row per token, round " + std::to_string( round ) ) ;
+        TEST_CHECK( context, mismatches == 0, std::to_string( mismatches ) + " rows differ from GetToken(), round " + std::to_string( round ) ) ;
+
+        // the columns are built again after the tokens change
+        std::vector<std::string> newLines = RandomLines( random, 3 ) ;
+        tp.ReplaceLines( 10 * round, 2, newLines ) ;
+
+    } // for
+
+    TokenProcessor empty ;
+    TEST_CHECK( context, empty.GetColumns().Size() == 0, "no columns of nothing" ) ;
+
+} // TestColumns()
+
+// Decoded contents stay where they are until Clear(), also when the arena is shared.
+void TestArena( TestContext & context ) {
+
+    std::string line ;
+    for ( int i = 0 ; i < 50 ; i++ ) {
+        line += "\"s" + std::to_string( i ) + "\\t\" 'q' " ;
+    } // for
+
+    std::string want = BriefLine<TokenProcessor>( line ) ;
+    TokenArena arena( 64 ) ;
+    TokenProcessor one, two ;
+
+    one.SetArena( &arena ) ;
+    two.SetArena( &arena ) ;
+    one.CutLine( line ) ;
+    two.CutLine( line ) ;
+    TEST_EQUAL( context, Brief( one ), want, "the first processor of a shared arena" ) ;
+    TEST_EQUAL( context, Brief( two ), want, "the second processor of a shared arena" ) ;
+    TEST_CHECK( context, arena.GetBlockCount() > 1, "more blocks than one" ) ;
+
+    // Clear() leaves a shared arena to its owner
+    one.Clear() ;
+    two.BackToBeginning() ;
+    TEST_EQUAL( context, Brief( two ), want, "after Clear() of the other processor" ) ;
+
+    // the own arena is reused after Clear(), and SetArena( NULL ) goes back to it
+    TokenProcessor own ;
+    for ( int round = 0 ; round < 3 ; round++ ) {
+        own.Clear() ;
+        own.SetArena( round == 1 ? &arena : NULL ) ;
+        own.CutLine( line ) ;
+        TEST_EQUAL( context, Brief( own ), want, "round " + std::to_string( round ) ) ;
+    } // for
+
+} // TestArena()
+
+void TestPositions( TestContext & context ) {
+
+    TokenProcessor tp ;
+    TokenView token ;
+    size_t line = 0, column = 0 ;
+
+    tp.CutLine( "ab" ) ;
+    tp.CutLine( "" ) ;
+    tp.CutLine( "  cd" ) ;
+
+    TEST_CHECK( context, tp.GetLineCount() == 3, "GetLineCount()" ) ;
+    TEST_EQUAL( context, std::string( tp.GetLine( 0 ) ) + "|" + std::string( tp.GetLine( 1 ) ) + "|" + std::string( tp.GetLine( 2 ) ),
+                "ab||  cd", "GetLine()" ) ;
+
+    const size_t offsets[] = { 0, 2, 3, 4, 6, 7, 8 } ;
+    const char * const want[] = { "0:0", "0:2", "1:0", "2:0", "2:2", "2:3", "2:4" } ;
+
+    for ( size_t i = 0 ; i < sizeof( offsets ) / sizeof( offsets[0] ) ; i++ ) {
+        bool found = tp.GetPosition( offsets[i], line, column ) ;
+        TEST_EQUAL( context, found ? std::to_string( line ) + ":" + std::to_string( column ) : "not found", want[i],
+                    "GetPosition( " + std::to_string( offsets[i] ) + " )" ) ;
+    } // for
+
+    tp.GetToken( token, 2 ) ;
+    TEST_CHECK( context, token.line == 2 && token.column == 2 && token.offset == 6, "where \"cd\" is" ) ;
+
+    // a mapped file without a last '\n'
+    std::string path = context.Path( "source.txt" ) ;
+    WriteFile( path, "x\ny z" ) ;
+    TokenProcessor mapped ;
+    mapped.CutMappedFile( path ) ;
+    TEST_CHECK( context, mapped.GetLineCount() == 2 && mapped.GetLine( 1 ) == "y z", "the last line of a mapped file" ) ;
+    remove( path.c_str() ) ;
+
+    // a stream knows only the lines it holds
+    std::string text ;
+    for ( int i = 0 ; i < 100 ; i++ ) {
+        text += "line" + std::to_string( i ) + "\n" ;
+    } // for
+
+    std::istringstream inStream( text ) ;
+    TokenProcessor stream ;
+    stream.OpenStream( inStream, 8 ) ;
+    stream.Skip( 90 ) ;
+    stream.GetToken( token ) ;
+    TEST_CHECK( context, token.line == 90 && token.offset == text.find( "line90" ), "lines and offsets of a stream" ) ;
+    TEST_CHECK( context, !stream.GetPosition( 0, line, column ), "no position of a dropped line" ) ;
+    TEST_CHECK( context, stream.GetPosition( token.offset + 2, line, column ) && line == 90 && column == 2, "the position of a line held" ) ;
+
+} // TestPositions()
+
+void TestComments( TestContext & context ) {
+
+    const char * const lines[] = {
+        "a /* x */ b // c",
+        "d /* x",
+        "y */ e",
+        "f // x \\",
+        "still",
+        "g \"ab\\",
+        "cd\" 'q' '\\n'",
+        "h /* open"
+    } ;
+
+    const char * const want[] = {
+        // COMMENTS_OFF: comments are delimiters, and a '\\' joins nothing
+        "1:a 4:/* 1:x 4:*/ 1:b 4:// 1:c 1:d 4:/* 1:x 1:y 4:*/ 1:e 1:f 4:// 1:x 4:\\ 1:still "
+        "1:g 5:\"ab\\{ab\\} 1:cd 5:\" 'q' '\\n'{ 'q' '\n'} 1:h 4:/* 1:open",
+        // COMMENTS_SKIP
+        "1:a 1:b 1:d 1:e 1:f 1:g 5:\"ab\\\ncd\"{abcd} 6:'q'{q} 6:'\\n'{\n} 1:h",
+        // COMMENTS_KEEP, a comment left open by the last line ends with the input
+        "1:a 7:/* x */ 1:b 7:// c 1:d 7:/* x\ny */ 1:e 1:f 7:// x \\\nstill 1:g 5:\"ab\\\ncd\"{abcd} "
+        "6:'q'{q} 6:'\\n'{\n} 1:h 7:/* open"
+    } ;
+
+    for ( int mode = COMMENTS_OFF ; mode <= COMMENTS_KEEP ; mode++ ) {
+
+        TokenProcessor tp ;
+        tp.SetCommentMode( mode ) ;
+        for ( size_t i = 0 ; i < sizeof( lines ) / sizeof( lines[0] ) ; i++ ) {
+            tp.CutLine( lines[i] ) ;
+        } // for
+
+        tp.EndInput() ;
+        TEST_EQUAL( context, Brief( tp ), want[mode], "comment mode " + std::to_string( mode ) ) ;
+
+    } // for
+
+    // a comment over lines is one token of its first line
+    TokenProcessor tp ;
+    TokenView token ;
+
+    tp.SetCommentMode( COMMENTS_KEEP ) ;
+    tp.CutLine( "d /* x" ) ;
+    tp.CutLine( "y */ e" ) ;
+    tp.GetToken( token, 2 ) ;
+    TEST_CHECK( context, token.type == COMMENT && token.line == 0 && token.column == 2 && token.offset == 2, "where the comment is" ) ;
+    tp.GetToken( token ) ;
+    TEST_CHECK( context, token.line == 1 && token.column == 5 && token.offset == 12, "where the token after it is" ) ;
+
+    // until EndInput() an open comment is pending, and holds back no tokens before it
+    TokenProcessor open ;
+    open.SetCommentMode( COMMENTS_KEEP ) ;
+    open.CutLine( "a /* x" ) ;
+    TEST_EQUAL( context, Brief( open ), "1:a", "before EndInput()" ) ;
+    open.EndInput() ;
+    TEST_EQUAL( context, Brief( open ), "7:/* x", "after EndInput()" ) ;
+
+} // TestComments()
+
+static std::string Text( const TokenView & token ) {
+    return std::string( token.token ) ;
+} // Text()
+
+// Peeks and skips of "walker", a processor or a cursor, against "all" the tokens from where it is.
+template <class Walker>
+static size_t CheckWalk( Walker & walker, const std::vector<std::string> & all, TestRandom & random ) {
+
+    size_t mismatches = 0 ;
+    TokenView token ;
+
+    for ( size_t index = 0 ; index <= all.size() ; ) {
+
+        size_t ahead = random.Next( 5 ) ;
+        bool peeked = walker.PeekToken( token, ahead ) ;
+
+        if ( peeked != ( index + ahead < all.size() ) || ( peeked && DumpToken( token ) != all[index + ahead] ) ) {
+            mismatches++ ;
+        } // if
+
+        size_t count = random.Next( 3 ) ;
+        size_t want = ( count < all.size() - index ? count : all.size() - index ) ;
+        mismatches += ( walker.Skip( count ) != want ) ;
+        index += want ;
+
+        bool more = walker.GetToken( token ) ;
+        if ( more != ( index < all.size() ) || ( more && DumpToken( token ) != all[index] ) ) {
+            mismatches++ ;
+        } // if
+
+        index++ ;
+
+    } // for
+
+    return mismatches ;
+
+} // CheckWalk()
+
+void TestCursors( TestContext & context ) {
+
+    TestRandom random( 9 ) ;
+    TokenProcessor tp ;
+    TokenView tokens[64] ;
+    std::vector<std::string> all ;
+
+    CutLines( tp, RandomLines( random, 300 ) ) ;
+    while ( tp.GetToken( tokens[0] ) ) {
+        all.push_back( DumpToken( tokens[0] ) ) ;
+    } // while
+
+    // GetTokens() in batches of any size gives what GetToken() gives
+    const size_t batches[] = { 1, 3, 64 } ;
+    std::string want ;
+    for ( size_t i = 0 ; i < all.size() ; i++ ) {
+        want += all[i] ;
+    } // for
+
+    for ( size_t i = 0 ; i < sizeof( batches ) / sizeof( batches[0] ) ; i++ ) {
+
+        std::string got, cursorGot ;
+        size_t count = 0 ;
+
+        tp.BackToBeginning() ;
+        while ( ( count = tp.GetTokens( tokens, batches[i] ) ) > 0 ) {
+            for ( size_t j = 0 ; j < count ; j++ ) {
+                got += DumpToken( tokens[j] ) ;
+            } // for
+        } // while
+
+        TokenCursor cursor( tp ) ;
+        while ( ( count = cursor.GetTokens( tokens, batches[i] ) ) > 0 ) {
+            for ( size_t j = 0 ; j < count ; j++ ) {
+                cursorGot += DumpToken( tokens[j] ) ;
+            } // for
+        } // while
+
+        TEST_EQUAL( context, got, want, "GetTokens() by " + std::to_string( batches[i] ) ) ;
+        TEST_EQUAL( context, cursorGot, want, "GetTokens() of a cursor by " + std::to_string( batches[i] ) ) ;
+
+    } // for
+
+    tp.BackToBeginning() ;
+    TEST_CHECK( context, CheckWalk( tp, all, random ) == 0, "PeekToken() and Skip()" ) ;
+    TokenCursor walker( tp ) ;
+    TEST_CHECK( context, CheckWalk( walker, all, random ) == 0, "PeekToken() and Skip() of a cursor" ) ;
+
+    // a cursor starts where the processor is, moves on its own, and does not move the processor
+    TokenProcessor small ;
+    TokenView token ;
+
+    small.CutLine( "a b c" ) ;
+    small.CutLine( "d e" ) ;
+    small.GetToken( token ) ;
+    TokenCursor cursor = small.GetCursor() ;
+    TokenCursor other = small.GetCursor() ;
+    cursor.GetToken( token ) ;
+    TEST_EQUAL( context, Text( token ), "b", "the cursor starts at the processor" ) ;
+    cursor.Skip( 2 ) ;
+    cursor.PeekToken( token, 0 ) ;
+    TEST_EQUAL( context, Text( token ), "e", "the cursor skipped" ) ;
+    other.GetToken( token ) ;
+    TEST_EQUAL( context, Text( token ), "b", "another cursor" ) ;
+    small.GetToken( token ) ;
+    TEST_EQUAL( context, Text( token ), "b", "the processor after the cursors moved" ) ;
+
+} // TestCursors()
+
+void TestMarks( TestContext & context ) {
+
+    TokenProcessor tp ;
+    TokenView token ;
+
+    tp.CutLine( "a b c" ) ;
+    tp.CutLine( "d e" ) ;
+
+    tp.GetToken( token ) ;
+    TokenMark first = tp.Mark() ;
+    tp.GetToken( token ) ;
+    TokenMark second = tp.Mark() ;
+    tp.GetToken( token, 2 ) ;
+    TEST_EQUAL( context, Text( token ), "d", "GetToken() twice" ) ;
+
+    TEST_CHECK( context, tp.Reset( second ), "Reset() to the inner mark" ) ;
+    tp.GetToken( token ) ;
+    TEST_EQUAL( context, Text( token ), "c", "the token after the inner mark" ) ;
+    TEST_CHECK( context, tp.Reset( first ), "Reset() to the outer mark" ) ;
+    tp.GetToken( token ) ;
+    TEST_EQUAL( context, Text( token ), "b", "the token after the outer mark" ) ;
+
+    tp.Skip( 10 ) ;
+    TokenMark end = tp.Mark() ;
+    TEST_CHECK( context, !tp.GetToken( token ), "nothing after the last token" ) ;
+    TEST_CHECK( context, tp.Reset( end ), "Reset() to the end" ) ;
+    TEST_CHECK( context, tp.Reset( first ), "Reset() back from the end" ) ;
+    TEST_EQUAL( context, Brief( tp ), "1:b 1:c 1:d 1:e", "the tokens after the outer mark" ) ;
+
+    TokenMark past = end ;
+    past.index++ ;
+    TEST_CHECK( context, !tp.Reset( past ), "no Reset() past the end" ) ;
+
+    tp.Release( first ) ;
+    tp.Release( second ) ;
+    tp.Release( end ) ;
+
+    // the marks of a cursor are the processor's, and are checked the same way
+    tp.BackToBeginning() ;
+    tp.GetToken( token ) ;
+    TokenCursor cursor = tp.GetCursor() ;
+    cursor.GetToken( token ) ;
+    TokenMark mark = cursor.Mark() ;
+    cursor.Skip( 2 ) ;
+    TEST_CHECK( context, cursor.Reset( mark ), "Reset() of a cursor" ) ;
+    cursor.GetToken( token ) ;
+    TEST_EQUAL( context, Text( token ), "c", "the token after the cursor's mark" ) ;
+    TEST_CHECK( context, cursor.Reset( second ), "Reset() of a cursor to a mark of the processor" ) ;
+    cursor.GetToken( token ) ;
+    TEST_EQUAL( context, Text( token ), "c", "the token after the processor's mark" ) ;
+    TEST_CHECK( context, cursor.Reset( end ), "Reset() of a cursor to the end" ) ;
+    TEST_CHECK( context, !cursor.Reset( past ), "no Reset() of a cursor past the end" ) ;
+    TEST_CHECK( context, !cursor.GetToken( token ), "the cursor stays at the end" ) ;
+
+    // a stream keeps every token after a mark, and drops them once it is released
+    std::string text ;
+    for ( int i = 0 ; i < 500 ; i++ ) {
+        text += "w" + std::to_string( i ) + " " + std::to_string( i ) + "\n" ;
+    } // for
+
+    std::istringstream inStream( text ) ;
+    TokenProcessor stream ;
+    stream.OpenStream( inStream, 16 ) ;
+
+    stream.Skip( 100 ) ; // the lines of these are dropped already
+    stream.GetToken( token ) ;
+    TokenMark streamMark = stream.Mark() ;
+    std::string firstRead, secondRead ;
+    for ( int i = 0 ; i < 400 && stream.GetToken( token ) ; i++ ) {
+        firstRead += Text( token ) + " " ;
+    } // for
+
+    TEST_CHECK( context, stream.Reset( streamMark ), "Reset() of a stream to a kept token" ) ;
+
+    // a mark the stream never gave is not released, so the tokens stay kept
+    TokenMark never = stream.Mark() ;
+    stream.Release( never ) ;
+    never.index += 1000 ;
+    stream.Release( never ) ;
+
+    for ( int i = 0 ; i < 400 && stream.GetToken( token ) ; i++ ) {
+        secondRead += Text( token ) + " " ;
+    } // for
+
+    TEST_EQUAL( context, secondRead, firstRead, "the tokens after the mark of a stream" ) ;
+    stream.Skip( 200 ) ; // past the tokens read before, so more lines are pulled
+    TEST_CHECK( context, stream.Reset( streamMark ), "Reset() of a stream after releasing a bad mark" ) ;
+
+    TokenCursor streamCursor = stream.GetCursor() ;
+    TokenMark dropped = streamMark ;
+    dropped.index = 0 ;
+    TEST_CHECK( context, !streamCursor.Reset( dropped ), "no Reset() of a cursor to a dropped token" ) ;
+
+    stream.Release( streamMark ) ;
+    size_t rest = 0 ;
+    while ( stream.GetToken( token ) ) {
+        rest++ ;
+    } // while
+
+    TEST_CHECK( context, rest == 1000 - 101, "the rest of the stream, " + std::to_string( rest ) + " tokens" ) ;
+    TEST_CHECK( context, !stream.Reset( streamMark ), "no Reset() of a stream to a dropped token" ) ;
+
+} // TestMarks()
+
+void TestOutput( TestContext & context ) {
+
+    TokenProcessor tp ;
+    MemorySink sink ;
+
+    tp.CutLine( "a = \"s\" ;" ) ;
+    tp.CutLine( "" ) ;
+    tp.CutLine( "  b1 3.5" ) ;
+
+    TEST_CHECK( context, tp.Output( sink, true, true ), "Output()" ) ;
+    TEST_EQUAL( context, sink.Data(),
+                "---------- Tokens ----------\n"
+                "[a]  [=]  [\"s\"]  [;]  \n"
+                "[b1]  [3.5]  \n"
+                "----------------------------\n", "Output() with brackets" ) ;
+
+    sink.Clear() ;
+    tp.Output( sink, false, false ) ;
+    TEST_EQUAL( context, sink.Data(), "a  =  \"s\"  ;  \nb1  3.5  \n", "Output() without brackets" ) ;
+
+    sink.Clear() ;
+    TEST_CHECK( context, tp.OutputOriginal( sink, true ), "OutputOriginal()" ) ;
+    TEST_EQUAL( context, sink.Data(),
+                "---------- Original ----------\n"
+                "a = \"s\" ;\n"
+                "\n"
+                "  b1 3.5\n"
+                "------------------------------\n", "OutputOriginal()" ) ;
+
+    // the same text through a stream and through std::cout
+    std::ostringstream out ;
+    StreamSink streamSink( out ) ;
+    tp.Output( streamSink, false, false ) ;
+    TEST_EQUAL( context, out.str(), "a  =  \"s\"  ;  \nb1  3.5  \n", "Output() to a StreamSink" ) ;
+
+    std::ostringstream coutText ;
+    std::streambuf * coutBuffer = std::cout.rdbuf( coutText.rdbuf() ) ;
+    tp.OutputOriginal( false ) ;
+    std::cout.rdbuf( coutBuffer ) ;
+    TEST_EQUAL( context, coutText.str(), "a = \"s\" ;\n\n  b1 3.5\n", "OutputOriginal() to std::cout" ) ;
+
+} // TestOutput()
+
+// "text" without '\r' and the spaces that end lines, which CompareOutput.cmake does not compare either.
+static std::string ComparableOutput( const std::string & text ) {
+
+    std::string comparable ;
+
+    for ( char ch : text ) {
+        if ( ch == '\n' ) {
+            comparable.erase( comparable.find_last_not_of( ' ' ) + 1 ) ;
+        } // if
+        if ( ch != '\r' ) {
+            comparable += ch ;
+        } // if
+    } // for
+
+    return comparable ;
+
+} // ComparableOutput()
+
+// Output() of a file cut by a processor of "Policy", as the drivers write it.
+template <class Policy>
+static std::string PolicyOutput( const std::string & path ) {
+
+    BasicTokenProcessor<Policy> tp ;
+    MemorySink sink ;
+    std::fstream inFile( path.c_str(), std::ios::in ) ;
+
+    tp.CutFile( inFile ) ;
+    tp.Output( sink, true, true ) ;
+    return ComparableOutput( sink.Data() ) ;
+
+} // PolicyOutput()
+
+// The policies of v1 and v2 give the tokens the drivers of v1 and v2 gave, and v3 its own.
+void TestPolicies( TestContext & context ) {
+
+    std::string input = std::string( TOKEN_TESTS_SOURCE_DIR ) + "/test_input/test01.txt" ;
+    std::string golden = std::string( TOKEN_TESTS_SOURCE_DIR ) + "/test_output/test01_" ;
+
+    TEST_CHECK( context, !ReadFile( input ).empty(), "reading " + input ) ;
+    TEST_EQUAL( context, PolicyOutput<TokenPolicyV1>( input ), ComparableOutput( ReadFile( golden + "v1_output.txt" ) ), "TokenPolicyV1" ) ;
+    TEST_EQUAL( context, PolicyOutput<TokenPolicyV2>( input ), ComparableOutput( ReadFile( golden + "v2_output.txt" ) ), "TokenPolicyV2" ) ;
+    TEST_EQUAL( context, PolicyOutput<TokenPolicyV3>( input ), ComparableOutput( ReadFile( golden + "v3_output.txt" ) ), "TokenPolicyV3" ) ;
+
+} // TestPolicies()
+
+struct StatsCalls {
+    std::vector<size_t> bytes ; // TokenStats::bytes of each call
+} ; // struct StatsCalls
+
+static void CountStatsCall( const TokenStats & stats, void * context ) {
+    static_cast<StatsCalls *>( context )->bytes.push_back( stats.bytes ) ;
+} // CountStatsCall()
+
+// GetStats() of known lines with TOKEN_PROCESSOR_STATS 1, and nothing at all with 0.
+// Allocations are only compared with each other, as how often a vector grows is up to the library.
+void TestStats( TestContext & context ) {
+
+    const char * const lines[] = { "int a = 42 ;", "x = 3.5 + \"s\\tr\" ; // note", "", "longest_identifier_here 'c'" } ;
+    TokenProcessor tp ;
+
+    tp.SetCommentMode( COMMENTS_KEEP ) ;
+    for ( const char * line : lines ) {
+        tp.CutLine( line ) ;
+    } // for
+    tp.EndInput() ;
+
+    TokenStats stats = tp.GetStats() ;
+    std::string counts ;
+    for ( int type = UNKNOWN ; type <= COMMENT ; type++ ) {
+        counts += std::to_string( stats.typeCounts[type] ) + ( type < COMMENT ? " " : "" ) ;
+    } // for
+
+    // a processor that only cuts plain strings, and one that decodes one into the arena
+    TokenProcessor plain, decoded ;
+    plain.CutLine( "\"s_tr\"" ) ;
+    decoded.CutLine( "\"s\\tr\"" ) ;
+
+    // the callback, once per 100 bytes of lines of 10
+    TokenProcessor called ;
+    StatsCalls calls ;
+    called.SetStatsCallback( CountStatsCall, &calls, 100 ) ;
+    for ( int i = 0 ; i < 100 ; i++ ) {
+        called.CutLine( "123456789" ) ;
+    } // for
+
+# if TOKEN_PROCESSOR_STATS
+    TEST_EQUAL( context, counts, "0 4 1 1 5 1 1 1", "tokens by type" ) ;
+    TEST_CHECK( context, stats.tokens == 14, "tokens" ) ;
+    TEST_CHECK( context, stats.bytes == 13 + 27 + 1 + 28, "bytes, with the line ends" ) ;
+    TEST_CHECK( context, stats.lines == 4, "lines" ) ;
+    TEST_CHECK( context, stats.longestToken == 23 && stats.longestTokenLine == 3, "the longest token" ) ;
+    TEST_CHECK( context, stats.allocations > 0, "allocations of a new processor" ) ;
+    TEST_CHECK( context, decoded.GetStats().allocations == plain.GetStats().allocations + 1, "an arena block for decoded contents" ) ;
+
+    // Clear() keeps the memory, so the same lines again need none
+    tp.Clear() ;
+    tp.ResetStats() ;
+    for ( const char * line : lines ) {
+        tp.CutLine( line ) ;
+    } // for
+    tp.EndInput() ;
+    TEST_CHECK( context, tp.GetStats().tokens == 14 && tp.GetStats().allocations == 0, "no allocations after Clear()" ) ;
+
+    // CutFile() counts the same, and its reading apart from its cutting
+    std::string path = context.Path( "lines.txt" ) ;
+    TokenProcessor read ;
+    std::vector<std::string> fileLines( lines, lines + 4 ) ;
+    WriteFile( path, JoinLines( fileLines ) ) ;
+    std::fstream inFile( path.c_str(), std::ios::in ) ;
+    read.SetCommentMode( COMMENTS_KEEP ) ;
+    read.CutFile( inFile ) ;
+    TEST_CHECK( context, read.GetStats().tokens == 14 && read.GetStats().bytes == stats.bytes && read.GetStats().lines == 4,
+                "the counts of CutFile()" ) ;
+    TEST_CHECK( context, read.GetStats().ioSeconds >= 0.0 && read.GetStats().lexSeconds > 0.0, "the seconds of CutFile()" ) ;
+    remove( path.c_str() ) ;
+
+    bool everyInterval = ( calls.bytes.size() == 10 ) ;
+    for ( size_t i = 0 ; i < calls.bytes.size() ; i++ ) {
+        everyInterval = everyInterval && calls.bytes[i] == 100 * ( i + 1 ) ;
+    } // for
+    TEST_CHECK( context, everyInterval, std::to_string( calls.bytes.size() ) + " calls of the callback, one per 100 bytes" ) ;
+# else
+    TEST_EQUAL( context, counts, "0 0 0 0 0 0 0 0", "no tokens by type" ) ;
+    TEST_CHECK( context, stats.tokens == 0 && stats.bytes == 0 && stats.lines == 0 && stats.longestToken == 0 &&
+                stats.allocations == 0 && decoded.GetStats().allocations == 0, "nothing counted" ) ;
+    TEST_CHECK( context, calls.bytes.empty(), "no calls of the callback" ) ;
+# endif
+
+} // TestStats()